@@ -0,0 +1,69 @@
+#!/bin/sh
+# コンパイルサーバのスループット計測
+# 小さな.dcファイルを多数生成し、1ファイルごとにdccを起動する場合と
+# dcc --serveに対してdcc-clientで要求を送る場合の処理時間を比較する
+# 使い方: sh bench/server_bench.sh [ファイル数] [サーバのワーカ数]
+
+N=${1:-200}
+WORKERS=${2:-1}
+BIN_DIR=${BIN_DIR:-./bin}
+WORK=$(mktemp -d)
+SOCK=$WORK/dcc.sock
+
+trap 'rm -rf $WORK' EXIT
+
+i=0
+while [ $i -lt $N ]; do
+    cat > $WORK/f$i.dc <<SRC
+int f$i(int a, int b) {
+    int c;
+    c = a * $i + b;
+    return c;
+}
+
+int main() {
+    int x;
+    x = 3;
+    printnum(f$i(x, 4));
+    return 0;
+}
+SRC
+    i=$((i + 1))
+done
+
+now() { date +%s.%N; }
+
+# 1ファイルごとにプロセスを起動する
+start=$(now)
+i=0
+while [ $i -lt $N ]; do
+    $BIN_DIR/dcc $WORK/f$i.dc -o $WORK/p$i.ll || exit 1
+    i=$((i + 1))
+done
+process_time=$(awk "BEGIN { print $(now) - $start }")
+
+# 常駐サーバに要求を送る
+$BIN_DIR/dcc --serve $SOCK -j $WORKERS 2>$WORK/server.log &
+while [ ! -S $SOCK ]; do sleep 0.1; done
+start=$(now)
+i=0
+while [ $i -lt $N ]; do
+    $BIN_DIR/dcc-client $SOCK $WORK/f$i.dc -o $WORK/s$i.ll || exit 1
+    i=$((i + 1))
+done
+server_time=$(awk "BEGIN { print $(now) - $start }")
+$BIN_DIR/dcc-client $SOCK --shutdown
+wait
+
+# 出力が一致することを確認する
+i=0
+while [ $i -lt $N ]; do
+    cmp -s $WORK/p$i.ll $WORK/s$i.ll || { echo "output mismatch: f$i.dc"; exit 1; }
+    i=$((i + 1))
+done
+
+echo "files: $N"
+awk -v n=$N -v p=$process_time -v s=$server_time 'BEGIN {
+    printf "per-process: %.3fs (%.1f files/s)\n", p, n / p
+    printf "server:      %.3fs (%.1f files/s)\n", s, n / s
+}'
@@ -1,8 +1,21 @@
 #ifndef _APP_H_
+#define _APP_H_
 
 // 必要になる機能を書いてるところ的な?
 
+#include<cstdio>
+
+// コンパイルキャッシュのキーに含める (出力が変わる変更をしたら上げる)
+#define DCC_VERSION "0.2.0"
+
 #define SAFE_DELETE(x) {delete x;x=NULL;}
 #define SAFE_DELETEA(x) {delete[] x;x=NULL;}
 
+/// 診断メッセージの出力先 (スレッドごと)
+/// 既定は標準エラー コンパイルサーバはリクエストの間だけ差し替え、メッセージをクライアントに返す
+inline FILE *&diagStream() {
+    static thread_local FILE *stream = stderr;
+    return stream;
+}
+
 #endif
@@ -0,0 +1,81 @@
+#ifndef ARENA_HPP
+#define ARENA_HPP
+
+#include<cstdio>
+#include<cstring>
+#include<memory>
+#include<new>
+#include<utility>
+#include<llvm/ADT/ArrayRef.h>
+#include<llvm/ADT/StringRef.h>
+#include<llvm/Support/Allocator.h>
+#include "app.hpp"
+
+/// フロントエンド用アリーナ
+/// AST、名前文字列などをバンプポインタ方式で確保し、個別には解放しない
+/// release()またはデストラクタで一括して解放する
+/// 確保したオブジェクトのデストラクタは呼ばれないので、ここで確保するクラスは
+/// 解放が必要なメンバ(std::string, std::vectorなど)を持たないこと
+class Arena {
+    private:
+        llvm::BumpPtrAllocator Allocator;
+        // create()で確保したオブジェクトの数
+        size_t NodeCount;
+
+    public:
+        Arena() : NodeCount(0) {}
+        ~Arena() {}
+
+        // オブジェクトを確保してコンストラクタを呼ぶ
+        template<typename T, typename... Args>
+        T *create(Args&&... args) {
+            NodeCount++;
+            return new (Allocator.Allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+        }
+
+        // 文字列をアリーナにコピーする
+        llvm::StringRef copyString(llvm::StringRef str) {
+            if (str.empty()) {
+                return llvm::StringRef();
+            }
+            char *buf = static_cast<char*>(Allocator.Allocate(str.size(), 1));
+            memcpy(buf, str.data(), str.size());
+            return llvm::StringRef(buf, str.size());
+        }
+
+        // 配列をアリーナにコピーする (要素はポインタなど単純な型に限る)
+        // コピーした配列はASTの書き換えで要素を差し替えられる
+        template<typename T>
+        llvm::MutableArrayRef<T> copyArray(llvm::ArrayRef<T> array) {
+            if (array.empty()) {
+                return llvm::MutableArrayRef<T>();
+            }
+            T *buf = static_cast<T*>(Allocator.Allocate(sizeof(T) * array.size(), alignof(T)));
+            std::uninitialized_copy(array.begin(), array.end(), buf);
+            return llvm::MutableArrayRef<T>(buf, array.size());
+        }
+
+        // 確保したメモリを一括して解放する
+        void release() {
+            Allocator.Reset();
+            NodeCount = 0;
+        }
+
+        // 確保したオブジェクトの数を取得
+        size_t getNodeCount() { return NodeCount; }
+
+        // 割り当て済みのバイト数を取得
+        size_t getAllocatedBytes() { return Allocator.getBytesAllocated(); }
+
+        // OSから確保したバイト数を取得
+        size_t getReservedBytes() { return Allocator.getTotalMemory(); }
+
+        // 統計情報を表示
+        bool printStats(FILE *out, const char *name) {
+            fprintf(out, "arena %s: %zu nodes, %zu bytes allocated, %zu bytes reserved\n",
+                    name, getNodeCount(), getAllocatedBytes(), getReservedBytes());
+            return true;
+        }
+};
+
+#endif
@@ -3,7 +3,10 @@
 
 #include<string>
 #include "app.hpp"
+#include "arena.hpp"
 #include<vector>
+#include<llvm/ADT/ArrayRef.h>
+#include<llvm/ADT/StringRef.h>
 #include<llvm/Support/Casting.h>
 
 /// ｸﾗｽ宣言
@@ -33,6 +36,10 @@ enum AstID {
 
 // S: ステートメントとエクスプレッションの定義 p69
 
+// 以下のASTはTranslationUnitASTが持つArenaに確保し、一括して解放する
+// 個別のデストラクタは呼ばれないので、名前はStringRef、リストはArrayRefとして
+// Arena上の領域を参照する
+
 /// ASTの基底ｸﾗｽ
 class BaseAST {
     AstID ID;
@@ -56,12 +63,15 @@ class NullExprAST: public BaseAST {
 };
 
 /// 変数参照を表すｸﾗｽ
+/// 参照先は意味解析で関数内の変数の番号(スロット)に解決しておく
 class VariableAST: public BaseAST {
     // 変数名(ﾒﾝﾊﾞ変数)
-    std::string Name;
+    llvm::StringRef Name;
+    // 関数内の変数の番号 (FunctionStmtASTの変数宣言リストの位置)
+    int Slot;
 
     public:
-        VariableAST(const std::string &name) : BaseAST(VariableID), Name(name) {}
+        VariableAST(llvm::StringRef name, int slot) : BaseAST(VariableID), Name(name), Slot(slot) {}
         ~VariableAST() {}
 
         // VariableASTなのでtrueを返す
@@ -73,7 +83,10 @@ class VariableAST: public BaseAST {
         }
 
         // 変数名の取得
-        std::string getName() { return Name; }
+        llvm::StringRef getName() { return Name; }
+
+        // 変数の番号の取得
+        int getSlot() { return Slot; }
 };
 
 /// 整数型を表すAST
@@ -108,12 +121,14 @@ class VariableDeclAST: public BaseAST {
     
     private:
         // 変数名
-        std::string Name;
+        llvm::StringRef Name;
         // 変数宣言の種類
         DeclType Type;
+        // 関数内の変数の番号 引数は引数の位置と同じ番号になる
+        int Slot;
 
     public:
-        VariableDeclAST(const std::string &name) : BaseAST(VariableDeclID), Name(name) {}
+        VariableDeclAST(llvm::StringRef name) : BaseAST(VariableDeclID), Name(name), Slot(-1) {}
 
         // VariableDeclASTなのでtrue
         static inline bool classof(VariableDeclAST const*) { return true; }
@@ -125,25 +140,31 @@ class VariableDeclAST: public BaseAST {
         ~VariableDeclAST() {}
 
         // 変数名の取得
-        std::string getName() { return Name; }
+        llvm::StringRef getName() { return Name; }
 
         // 変数の宣言種別を設定
         bool setDeclType(DeclType type) { Type = type; return true; }
 
         // 変数の宣下種別を設定
         DeclType getType() { return Type; }
+
+        // 変数の番号を設定
+        void setSlot(int slot) { Slot = slot; }
+
+        // 変数の番号を取得
+        int getSlot() { return Slot; }
 };
 
 /// 二項演算子を表すAST
 class BinaryExprAST: public BaseAST {
     // 演算子の文字列表現
-    std::string Op;
+    llvm::StringRef Op;
     // 二項演算子の左辺と右辺
     BaseAST *LHS, *RHS;
 
     public:
-        BinaryExprAST(std::string op, BaseAST *lhs, BaseAST *rhs) : BaseAST(BinaryExprID), Op(op), LHS(lhs), RHS(rhs) {}
-        ~BinaryExprAST() {SAFE_DELETE(LHS); SAFE_DELETE(RHS);}
+        BinaryExprAST(llvm::StringRef op, BaseAST *lhs, BaseAST *rhs) : BaseAST(BinaryExprID), Op(op), LHS(lhs), RHS(rhs) {}
+        ~BinaryExprAST() {}
 
         // BinaryExprASTなのでtrue
         static inline bool classof(BinaryExprAST const*) { return true; }
@@ -154,25 +175,35 @@ class BinaryExprAST: public BaseAST {
         }
 
         // 演算子を取得する
-        std::string getOp() { return Op; }
+        llvm::StringRef getOp() { return Op; }
 
         // 左辺値を取得
         BaseAST *getLHS() { return LHS; }
 
         // 右辺を取得
         BaseAST *getRHS() { return RHS; }
+
+        // 左辺を差し替える
+        void setLHS(BaseAST *lhs) { LHS = lhs; }
+
+        // 右辺を差し替える
+        void setRHS(BaseAST *rhs) { RHS = rhs; }
 };
 
 /// 関数呼び出しを表すAST
+/// 呼び出し先は意味解析で関数の番号(PrototypeAST::getIndex)に解決しておく
 class CallExprAST: public BaseAST {
     // 関数名
-    std::string Callee;
+    llvm::StringRef Callee;
+    // 呼び出す関数の番号
+    int CalleeIndex;
     // 関数呼び出しの引数
-    std::vector<BaseAST*> Args;
+    llvm::MutableArrayRef<BaseAST*> Args;
     
     public:
-        CallExprAST(const std::string &callee, std::vector<BaseAST*> &args) : BaseAST(CallExprID), Callee(callee), Args(args) {}
-        ~CallExprAST();
+        CallExprAST(llvm::StringRef callee, int callee_index, llvm::MutableArrayRef<BaseAST*> args)
+            : BaseAST(CallExprID), Callee(callee), CalleeIndex(callee_index), Args(args) {}
+        ~CallExprAST() {}
 
         // callASTなのでTrue
         static inline bool classof(CallExprAST const*) { return true; }
@@ -183,12 +214,18 @@ class CallExprAST: public BaseAST {
         }
 
         // 呼び出す関数名の取得
-        std::string getCallee() { return Callee; }
+        llvm::StringRef getCallee() { return Callee; }
+
+        // 呼び出す関数の番号の取得
+        int getCalleeIndex() { return CalleeIndex; }
 
         // i番目の引数を取得
         BaseAST *getArgs(int i) {
-            if (i < Args.size()) return Args.at(i); else return NULL;
+            if (i < Args.size()) return Args[i]; else return NULL;
         }
+
+        // i番目の引数を差し替える
+        void setArg(int i, BaseAST *arg) { Args[i] = arg; }
 };
 
 /// ｼﾞｬﾝﾌﾟ(return)を表すAST
@@ -198,7 +235,7 @@ class JumpStmtAST: public BaseAST {
     BaseAST *Expr;
     public:
         JumpStmtAST(BaseAST *expr): BaseAST(JumpStmtID), Expr(expr) {}
-        ~JumpStmtAST() { SAFE_DELETE(Expr); }
+        ~JumpStmtAST() {}
 
         // JumpStmtASTなのでtrueを返す
         static inline bool classof(JumpStmtAST const*) { return true; }
@@ -210,6 +247,9 @@ class JumpStmtAST: public BaseAST {
 
         // return で返すExpressionを取得する
         BaseAST *getExpr() { return Expr; }
+
+        // return で返すExpressionを差し替える
+        void setExpr(BaseAST *expr) { Expr = expr; }
 };
 
 // E: ステートメントとエクスプレッションの定義 p69
@@ -218,61 +258,64 @@ class JumpStmtAST: public BaseAST {
 
 /// 関数定義(ステートメントの集合体)を表すAST
 /// statement, valiable_declarationのリスト -> function_statement
+/// 変数宣言とステートメントのリストは解析し終えてからArenaにコピーして渡す
 class FunctionStmtAST {
-    std::vector<VariableDeclAST*> VariableDecls;
-    std::vector<BaseAST*> StmtLists;
+    llvm::ArrayRef<VariableDeclAST*> VariableDecls;
+    llvm::MutableArrayRef<BaseAST*> StmtLists;
 
     public:
-        FunctionStmtAST() {}~FunctionStmtAST();
-
-        // 関数に変数を追加する
-        bool addVariableDeclaration(VariableDeclAST *vdecl);
-
-        // 関数にステートメントを追加する
-        bool addStatement(BaseAST *stmt) { 
-            StmtLists.push_back(stmt);
-            return true;
-        }
+        FunctionStmtAST(llvm::ArrayRef<VariableDeclAST*> vdecls, llvm::MutableArrayRef<BaseAST*> stmts)
+            : VariableDecls(vdecls), StmtLists(stmts) {}
+        ~FunctionStmtAST() {}
 
         // i番目変数を取得する
         VariableDeclAST *getVariableDecl(int i) {
             if (i < VariableDecls.size()) {
-                return VariableDecls.at(i);
+                return VariableDecls[i];
             } else {
                 return NULL;
             }
         }
 
+        // 変数宣言の数を取得する
+        int getVariableDeclNum() { return VariableDecls.size(); }
+
         // i番目のステートメントを取得する
         BaseAST *getStatement(int i) {
             if (i < StmtLists.size()) {
-                return StmtLists.at(i);
+                return StmtLists[i];
             } else {
                 return NULL;
             }
         }
+
+        // i番目のステートメントを差し替える
+        void setStatement(int i, BaseAST *stmt) { StmtLists[i] = stmt; }
 };
 
 /// プロトタイプ宣言の情報を保存するためのAST
 /// 変数名(引数)リストと関数を持つクラスとして定義
+/// 同じ名前のプロトタイプ宣言と関数定義には同じ関数の番号を割り当てる
 class PrototypeAST {
     // 変数名
-    std::string Name;
+    llvm::StringRef Name;
     // 引数の変数名
-    std::vector<std::string> Params;
+    llvm::ArrayRef<llvm::StringRef> Params;
+    // 関数の番号 (TranslationUnitAST内で0から振る)
+    int Index;
 
     public:
-        PrototypeAST(const std::string &name, const std::vector<std::string> &params) : Name(name), Params(params){}
+        PrototypeAST(llvm::StringRef name, llvm::ArrayRef<llvm::StringRef> params) : Name(name), Params(params), Index(-1) {}
 
         // 関数名を取得する
-        std::string getName() { return Name; }
+        llvm::StringRef getName() { return Name; }
 
         // i番目の引数名を取得する
-        std::string getParamName(int i) {
+        llvm::StringRef getParamName(int i) {
             if (i < Params.size()) {
-                return Params.at(i);
+                return Params[i];
             } else {
-                return NULL;
+                return llvm::StringRef();
             }
         }
 
@@ -280,6 +323,12 @@ class PrototypeAST {
         int getParamNum() {
             return Params.size();
         }
+
+        // 関数の番号を設定する
+        void setIndex(int index) { Index = index; }
+
+        // 関数の番号を取得する
+        int getIndex() { return Index; }
 };
 
 /// 関数を表すAST
@@ -291,10 +340,10 @@ class FunctionAST {
 
     public:
         FunctionAST(PrototypeAST *proto, FunctionStmtAST *body) : Proto(proto), Body(body){}
-        ~FunctionAST();
+        ~FunctionAST() {}
 
         // 関数名を取得する
-        std::string getName() {
+        llvm::StringRef getName() {
             return Proto -> getName();
         }
 
@@ -310,12 +359,19 @@ class FunctionAST {
 };
 
 /// ソースコードを表すAST
+/// 配下のAST、名前文字列を確保するArenaを所有し、破棄時に一括して解放する
 class TranslationUnitAST {
     std::vector<PrototypeAST*> Prototypes;
     std::vector<FunctionAST*> Functions;
+    Arena Nodes;
+    // 割り当てた関数の番号の数
+    int FunctionIndexNum;
 
     public:
-        TranslationUnitAST() {} ~TranslationUnitAST();
+        TranslationUnitAST() : FunctionIndexNum(0) {} ~TranslationUnitAST();
+
+        // ASTを確保するArenaを取得する
+        Arena &getArena() { return Nodes; }
 
         // モジュールにプロトタイプ宣言を追加する
         bool addPrototype(PrototypeAST *proto);
@@ -326,6 +382,18 @@ class TranslationUnitAST {
         // モジュールが空か判定する
         bool empty();
 
+        // 新しい関数の番号を割り当てる
+        int newFunctionIndex() { return FunctionIndexNum++; }
+
+        // 割り当てた関数の番号の数を取得する
+        int getFunctionIndexNum() { return FunctionIndexNum; }
+
+        // プロトタイプ宣言の数を取得する
+        int getPrototypeNum() { return Prototypes.size(); }
+
+        // 関数定義の数を取得する
+        int getFunctionNum() { return Functions.size(); }
+
         // i番目のプロトタイプ宣言を取得する
         PrototypeAST *getPrototype(int i) {
             if (i < Prototypes.size()) {
@@ -0,0 +1,38 @@
+#ifndef BATCH_HPP
+#define BATCH_HPP
+
+#include<atomic>
+#include<cstdio>
+#include<string>
+#include<thread>
+#include<vector>
+
+#include "app.hpp"
+#include "driver.hpp"
+#include "option.hpp"
+#include "timing.hpp"
+
+/// 複数ファイルの一括コンパイルクラス
+/// 入力ファイルをワーカスレッドのプールで並列にコンパイルする
+/// ワーカはそれぞれDriver(Parser, CodeGen, LLVMContext, Emitter)を持ち、
+/// 1つのファイルが失敗しても残りのファイルのコンパイルは続ける
+class BatchCompiler {
+    private:
+        OptionParser &Opt;
+        unsigned WorkerNum;
+        std::string RuntimePath;
+
+        std::atomic<size_t> Next;   // 次に取り出す入力ファイルの位置
+        std::vector<int> Status;    // 入力ファイルごとの終了ステータス
+
+    public:
+        BatchCompiler(OptionParser &opt, unsigned worker_num, std::string runtime_path)
+            : Opt(opt), WorkerNum(worker_num), RuntimePath(runtime_path), Next(0) {}
+        ~BatchCompiler() {}
+        int run();
+
+    private:
+        void workerLoop();
+};
+
+#endif
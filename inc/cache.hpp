@@ -0,0 +1,55 @@
+#ifndef CACHE_HPP
+#define CACHE_HPP
+
+#include<cstdio>
+#include<cstdlib>
+#include<memory>
+#include<string>
+#include<fcntl.h>
+#include<sys/file.h>
+#include<unistd.h>
+#include<llvm/ADT/StringExtras.h>
+#include<llvm/ADT/StringRef.h>
+#include<llvm/Config/llvm-config.h>
+#include<llvm/Support/CachePruning.h>
+#include<llvm/Support/Chrono.h>
+#include<llvm/Support/Error.h>
+#include<llvm/Support/FileSystem.h>
+#include<llvm/Support/Host.h>
+#include<llvm/Support/MemoryBuffer.h>
+#include<llvm/Support/Path.h>
+#include<llvm/Support/SHA1.h>
+#include<llvm/Support/raw_ostream.h>
+
+#include "app.hpp"
+#include "option.hpp"
+#include "runtime.hpp"
+
+/// コンパイルキャッシュクラス
+/// 最適化後のModuleをBitcodeにして、ソースのバイト列、dccとLLVMのバージョン、
+/// 最適化オプションから作ったキーでキャッシュディレクトリに保存する
+/// 同じキーのコンパイルでは字句解析から最適化までをやり直さずに出力だけを行う
+/// エントリは入力ファイル名と出力形式によらないので、別のパスにある同じソースや
+/// 出力形式の違うコンパイルでも同じエントリを使う
+/// エントリは一時ファイルに書いてからrenameするので、並行するdccが書きかけを読むことはない
+/// 合計サイズが上限を超えたら最後に使われた時刻の古いものから削除する(LRU)
+/// ヒット数とミス数はディレクトリ内のstatsファイルにプロセスをまたいで集計する
+class CompileCache {
+    private:
+        std::string Dir;
+        uint64_t MaxSize;   // キャッシュの合計サイズの上限 (バイト)
+
+    public:
+        CompileCache(std::string dir, uint64_t max_size) : Dir(dir), MaxSize(max_size) {}
+        ~CompileCache() {}
+        std::string computeKey(OptionParser &opt, llvm::StringRef source);
+        std::unique_ptr<llvm::MemoryBuffer> lookup(std::string key);
+        bool store(std::string key, llvm::StringRef data);
+        bool printStats(FILE *out);
+
+    private:
+        std::string getEntryPath(std::string key);
+        bool updateStats(uint64_t hits, uint64_t misses, uint64_t *total_hits, uint64_t *total_misses);
+};
+
+#endif
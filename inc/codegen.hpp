@@ -1,31 +1,34 @@
 #ifndef CODEGEN_HPP 
 #define CODEGEN_HPP
 
+#include<algorithm>
 #include<cstdio>
 #include<cstdlib>
 #include<map>
 #include<string>
 #include<vector>
-#include<llvm/ADT/APInt.h>
+#include<llvm/ADT/DenseMap.h>
+#include<llvm/ADT/SmallVector.h>
+#include<llvm/Bitcode/BitcodeReader.h>
+#include<llvm/Bitcode/BitcodeWriter.h>
 #include<llvm/IR/Constants.h>
-#include<llvm/ExecutionEngine/ExecutionEngine.h>
-#include<llvm/ExecutionEngine/MCJIT.h>
 #include<llvm/Linker/Linker.h>
 #include<llvm/IR/LLVMContext.h>
 #include<llvm/IR/Module.h>
-#include<llvm/IR/Metadata.h>
 #include<llvm/IR/IRBuilder.h>
-#include<llvm/IR/MDBuilder.h>
-#include<llvm/IR/ValueSymbolTable.h>
+#include<llvm/IR/LegacyPassManager.h>
+#include<llvm/Support/ThreadPool.h>
+#include<llvm/Support/Threading.h>
+#include<llvm/Transforms/Utils.h>
+#include<llvm/Transforms/Utils/Cloning.h>
 #include<llvm/Support/Casting.h>
+#include<llvm/Support/SourceMgr.h>
 #include<llvm/IRReader/IRReader.h>
 
-
-#include<llvm/ADT/STLExtras.h> // Add
-#include<llvm/Support/SourceMgr.h> // Add
-
 #include "app.hpp"
 #include "ast.hpp"
+#include "runtime.hpp"
+#include "timing.hpp"
 
 /// コード生成クラス
 class CodeGen {
@@ -33,26 +36,48 @@ class CodeGen {
         llvm::Function    *CurFunc;   // 現在生成中のFunction
         llvm::Module      *Mod;       // 生成したModuleを格納する
         llvm::IRBuilder<> *Builder;   // LLVM_IRを生成するIRBuilderクラス
+        llvm::Module      *Runtime;   // 読み込み済みのランタイム (linkRuntimeで複製してリンクする)
+        TimeReport        *Timing;    // 関数ごとの時間の計測 (NULLなら計測しない)
+        std::vector<llvm::Function*>   Functions; // 関数の番号から生成中のModuleのFunctionへの表
+        std::vector<llvm::AllocaInst*> Slots;     // 変数の番号から生成中の関数のallocaへの表
+        bool DirectSSA;           // allocaを使わず変数の値を直接SSAの値として追跡するか
+        // 直接SSA構築: BasicBlockごとの各変数の現在の値 (未定義の変数はNULL)
+        llvm::DenseMap<llvm::BasicBlock*, std::vector<llvm::Value*> > BlockDefs;
 
     public:
         CodeGen();
         ~CodeGen();
-        bool doCodeGen(TranslationUnitAST &tunit, std::string name);
+        bool doCodeGen(TranslationUnitAST &tunit, std::string name, unsigned jobs = 1);
         llvm::Module &getModule();
+        llvm::Module *releaseModule();
+        bool linkRuntime();
+        void setTimeReport(TimeReport *timing) { Timing = timing; }
+        void setDirectSSA(bool direct_ssa) { DirectSSA = direct_ssa; }
         llvm::LLVMContext context;
 
     private:
         bool generateTranslationUnit(TranslationUnitAST &tunit, std::string name);
+        bool generateParallel(TranslationUnitAST &tunit, std::string name, unsigned jobs);
+        bool generateFunctionRange(TranslationUnitAST &tunit, std::string name, int begin, int end);
+        bool generateDeclarations(TranslationUnitAST &tunit, llvm::Module *mod);
+        bool optimizeModule(llvm::Module *mod);
+        bool writeBitcode(llvm::SmallVectorImpl<char> &buffer);
+        void resetValueNames(llvm::Module *mod);
         llvm::Function *generateFunctionDefinition(FunctionAST *func, llvm::Module *mod);
         llvm::Function *generatePrototype(PrototypeAST *proto, llvm::Module *mod);
         llvm::Value *generateFunctionStatement(FunctionStmtAST *func_stmt);
         llvm::Value *generateVariableDeclaration(VariableDeclAST *vdecl);
         llvm::Value *generateStatement(BaseAST *stmt);
+        llvm::Value *generateExpression(BaseAST *expr);
+        llvm::Value *generateExpressionValue(BaseAST *expr, const llvm::Twine &name);
         llvm::Value *generateBinaryExpression(BinaryExprAST *bin_expr);
         llvm::Value *generateCallExpression(CallExprAST *call_expr);
         llvm::Value *generateJumpStatement(JumpStmtAST *jump_stmt);
         llvm::Value *generateVariable(VariableAST *var);
         llvm::Value *generateNumber(int value);
+        void writeVariable(int slot, llvm::BasicBlock *block, llvm::Value *value);
+        llvm::Value *readVariable(int slot, llvm::BasicBlock *block);
+        llvm::Value *readVariableRecursive(int slot, llvm::BasicBlock *block);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,63 @@
+#ifndef DRIVER_HPP
+#define DRIVER_HPP
+
+#include<cstdio>
+#include<memory>
+#include<string>
+#include<llvm/ADT/SmallVector.h>
+#include<llvm/Bitcode/BitcodeReader.h>
+#include<llvm/Bitcode/BitcodeWriter.h>
+#include<llvm/ExecutionEngine/ExecutionEngine.h>
+#include<llvm/ExecutionEngine/MCJIT.h>
+#include<llvm/IR/Verifier.h>
+#include<llvm/Support/DynamicLibrary.h>
+#include<llvm/Support/MemoryBuffer.h>
+
+#include "app.hpp"
+#include "cache.hpp"
+#include "codegen.hpp"
+#include "emitter.hpp"
+#include "memstats.hpp"
+#include "option.hpp"
+#include "parser.hpp"
+#include "simplify.hpp"
+#include "timing.hpp"
+
+/// コンパイルドライバクラス
+/// 1つのソースを構文解析からファイル出力(またはJIT実行)まで処理する
+/// Emitter(TargetMachine, 最適化パイプライン)とCodeGen(LLVMContext, ランタイム)は
+/// 続けて処理するソースで使い回す スレッド間では共有せず、スレッドごとに生成すること
+class Driver {
+    private:
+        Emitter *Backend;        // 最適化とファイル出力
+        CodeGen *Generator;      // コード生成 (LLVMContextを保持する)
+        unsigned CompileCount;   // Generatorで処理したソースの数
+        TimeReport *Timing;      // 時間の計測 (NULLなら計測しない)
+        MemoryStats *Memory;     // メモリ使用量の統計 (NULLなら記録しない)
+
+    public:
+        Driver(std::string runtime_path);
+        ~Driver();
+        void setTimeReport(TimeReport *timing) { Timing = timing; }
+        void printPassTimes() { Backend->printPassTimes(); }
+        void setMemoryStats(MemoryStats *memory) { Memory = memory; }
+        int compileFile(OptionParser &opt);
+        int compileFile(OptionParser &opt, std::string input_filename, unsigned jobs);
+        int compileBuffer(OptionParser &opt, std::unique_ptr<llvm::MemoryBuffer> source,
+                          llvm::SmallVectorImpl<char> &output);
+
+    private:
+        Parser *createParser(OptionParser &opt, std::string input_filename);
+        Parser *createParser(OptionParser &opt, std::unique_ptr<llvm::MemoryBuffer> source);
+        int compile(OptionParser &opt, Parser *parser, std::string input_filename, unsigned jobs,
+                    llvm::SmallVectorImpl<char> *output, llvm::SmallVectorImpl<char> *cache_entry = NULL);
+        int emitCached(OptionParser &opt, std::string input_filename, llvm::MemoryBuffer &entry,
+                       llvm::SmallVectorImpl<char> *output);
+        bool emitModule(OptionParser &opt, llvm::Module &mod, std::string input_filename,
+                        llvm::SmallVectorImpl<char> *output);
+        void recycleGenerator();
+        int runModule();
+        bool verifyModule(llvm::Module &mod);
+};
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef EMITTER_HPP
+#define EMITTER_HPP
+
+#include<cstdio>
+#include<string>
+#include<llvm/ADT/Optional.h>
+#include<llvm/ADT/SmallString.h>
+#include<llvm/Bitcode/BitcodeWriterPass.h>
+#include<llvm/IR/IRPrintingPasses.h>
+#include<llvm/IR/LegacyPassManager.h>
+#include<llvm/IR/Module.h>
+#include<llvm/MC/TargetRegistry.h>
+#include<llvm/IR/PassInstrumentation.h>
+#include<llvm/IR/PassTimingInfo.h>
+#include<llvm/Pass.h>
+#include<llvm/Passes/PassBuilder.h>
+#include<llvm/Support/Error.h>
+#include<llvm/Support/FileSystem.h>
+#include<llvm/Support/MemoryBuffer.h>
+#include<llvm/Support/Host.h>
+#include<llvm/Support/Path.h>
+#include<llvm/Support/Program.h>
+#include<llvm/Support/raw_ostream.h>
+#include<llvm/Target/TargetMachine.h>
+#include<llvm/Target/TargetOptions.h>
+#include<llvm/Transforms/Utils/Cloning.h>
+
+#include "app.hpp"
+#include "option.hpp"
+
+/// 出力クラス
+/// ホスト向けのTargetMachineでModuleを最適化し、アセンブリ、オブジェクトファイルに変換する
+/// 実行ファイルはオブジェクトファイルとランタイムをシステムのリンカ(cc)で結合して作る
+/// TargetMachineと構築した最適化パイプラインは複数のModuleで使い回す
+/// スレッド間では共有せず、スレッドごとに生成すること
+class Emitter {
+    private:
+        llvm::TargetMachine *Machine;   // ホスト向けのTargetMachine
+        std::string RuntimePath;        // 実行ファイルにリンクするランタイム
+
+        // 最適化パイプライン 解析結果を管理するAnalysisManagerはこの順に宣言する必要がある
+        llvm::LoopAnalysisManager LAM;
+        llvm::FunctionAnalysisManager FAM;
+        llvm::CGSCCAnalysisManager CGAM;
+        llvm::ModuleAnalysisManager MAM;
+        llvm::PassInstrumentationCallbacks Callbacks;
+        llvm::TimePassesHandler *PassTimes;  // パスごとの時間 (--time-reportのときだけ作る)
+        llvm::PassBuilder *Builder;
+        llvm::ModulePassManager *Pipelines[4];  // 最適化レベルごとの既定パイプライン
+        llvm::ModulePassManager *CustomPipeline;  // --passesで指定したパイプライン
+        std::string CustomPasses;
+
+    public:
+        Emitter(std::string runtime_path);
+        ~Emitter();
+        bool isValid() { return Machine != NULL; }
+        bool prepareModule(llvm::Module &mod);
+        bool optimizeModule(llvm::Module &mod, unsigned level, std::string passes);
+        bool emitFile(llvm::Module &mod, OutputKind kind, std::string filename);
+        bool emitBuffer(llvm::Module &mod, OutputKind kind, llvm::SmallVectorImpl<char> &buffer);
+        void printPassTimes();
+
+    private:
+        llvm::ModulePassManager *getPipeline(unsigned level, std::string passes);
+        bool emitStream(llvm::Module &mod, OutputKind kind, llvm::raw_pwrite_stream &stream);
+        bool emitIR(llvm::Module &mod, llvm::raw_pwrite_stream &stream);
+        bool emitBitcode(llvm::Module &mod, llvm::raw_pwrite_stream &stream);
+        bool emitMachineCode(llvm::Module &mod, OutputKind kind, llvm::raw_pwrite_stream &stream);
+        bool linkExecutable(std::string object_file, std::string filename);
+};
+
+#endif
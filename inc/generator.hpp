@@ -0,0 +1,58 @@
+#ifndef GENERATOR_HPP
+#define GENERATOR_HPP
+
+#include<cstdint>
+#include<cstdio>
+#include<string>
+#include<vector>
+
+#include "app.hpp"
+
+/// 生成するプログラムの大きさ
+struct GeneratorConfig {
+    unsigned Functions;   // 関数の数 (mainを除く)
+    unsigned Locals;      // 関数ごとのローカル変数の数
+    unsigned Statements;  // 関数ごとの代入文の数
+    unsigned Depth;       // 代入文の右辺の二項演算子の数
+    unsigned FanOut;      // 関数ごとの呼び出し文の数
+    uint32_t Seed;        // 被演算子を選ぶ擬似乱数の種
+
+    GeneratorConfig()
+        : Functions(200), Locals(4), Statements(8), Depth(4), FanOut(2), Seed(1) {}
+};
+
+/// 字句解析のマイクロベンチマーク用入力の種類
+/// 構文としては正しくなくてよいが、解析不能字句は含まない
+enum LexerInputKind {
+    LEXER_INPUT_WHITESPACE,  // 短いトークンと長い空白の並び
+    LEXER_INPUT_COMMENT,     // 長いブロックコメントと行コメント
+    LEXER_INPUT_IDENTIFIER,  // 長い識別子と数字
+    LEXER_INPUT_KIND_NUM,
+};
+
+const char *getLexerInputName(LexerInputKind kind);
+std::string generateLexerInput(LexerInputKind kind, size_t bytes, uint32_t seed = 1);
+
+/// ベンチマーク用の.dcプログラム生成クラス
+/// 関数 f<i>(a, b) を順に並べ、最後に f<N-1> を呼ぶ main を置く
+/// 呼び出しは定義済みの関数にだけ行うので、前方宣言なしでコンパイルできる
+/// 同じ設定と種からは常に同じプログラムを生成する
+class SourceGenerator {
+    private:
+        GeneratorConfig Config;
+        uint32_t State;     // 擬似乱数の状態
+        std::string Source; // 生成中のソース
+
+    public:
+        SourceGenerator(const GeneratorConfig &config) : Config(config), State(config.Seed) {}
+        ~SourceGenerator() {}
+        std::string generate();
+
+    private:
+        unsigned nextRandom(unsigned bound);
+        void generateFunction(unsigned index);
+        void generateOperand(unsigned assigned);
+        void generateMain();
+};
+
+#endif
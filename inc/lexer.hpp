@@ -1,13 +1,18 @@
 #ifndef LEXER_HPP
 #define LEXER_HPP
 
+#include<cstdint>
 #include<cstdio>
 #include<cstdlib>
-#include<fstream>
 #include<list>
+#include<memory>
 #include<string>
 #include<vector>
+#include<llvm/ADT/DenseMap.h>
+#include<llvm/ADT/StringRef.h>
+#include<llvm/Support/MemoryBuffer.h>
 #include "app.hpp"
+#include "scan.hpp"
 
 // トークンの種類
 // トークンが識別子、予約語、記号、数値のいずれかにあてはまるかという情報
@@ -22,85 +27,224 @@ enum TokenType {
     TOK_EOF,        // EOF
 };
 
-/// 個別トークン格納クラス
+/// トークンのインデックス
+/// 2GBを超える入力も扱えるよう64bitで持つ
+typedef uint64_t TokenIndex;
+
+/// 識別子表
+/// 識別子の文字列に0から始まる密なIDを割り当てる
+/// 文字列はコピーせずに参照するので、登録する文字列は表より長く生存すること
+class IdentifierTable {
+    private:
+        llvm::DenseMap<llvm::StringRef, int> IDs;
+        std::vector<llvm::StringRef> Names;
+
+    public:
+        // 識別子を登録してIDを取得する 登録済みなら既存のIDを返す
+        int intern(llvm::StringRef name) {
+            std::pair<llvm::DenseMap<llvm::StringRef, int>::iterator, bool> result =
+                IDs.insert(std::make_pair(name, (int)Names.size()));
+            if (result.second) {
+                Names.push_back(name);
+            }
+            return result.first->second;
+        }
+
+        // 登録済みの識別子のIDを取得する 未登録なら-1
+        int lookup(llvm::StringRef name) {
+            llvm::DenseMap<llvm::StringRef, int>::iterator iter = IDs.find(name);
+            if (iter == IDs.end()) {
+                return -1;
+            } else {
+                return iter->second;
+            }
+        }
+
+        // IDに対応する識別子を取得する
+        llvm::StringRef getName(int id) { return Names[id]; }
+
+        // 表が確保しているバイト数を取得
+        size_t getMemorySize() { return IDs.getMemorySize() + Names.capacity() * sizeof(llvm::StringRef); }
+
+        // 登録されている識別子の数を取得する
+        int size() { return Names.size(); }
+};
+
+/// 個別トークンクラス
+/// TokenStreamの配列から必要な時だけ組み立てる値型
+/// 文字列はソースバッファ上の(先頭, 長さ)のビューとして保持し、コピーしない
 class Token {
     private:
         TokenType Type;
-        std::string TokenString;
+        llvm::StringRef TokenString;
         int Number;
-        int Line;
+        uint64_t Line;
 
     public:
-    Token(std::string string, TokenType type, int line) : TokenString(string), Type(type), Line(line) {
-        // 数字が入れられた場合
-        if (type == TOK_DIGIT) {
-            Number = atoi(string.c_str());
-        } else {
-            Number = 0x7fffffff;
-        }
-    };
+    Token(llvm::StringRef string, TokenType type, uint64_t line, int number = 0x7fffffff)
+        : Type(type), TokenString(string), Number(number), Line(line) {};
     ~Token(){};
 
     // トークンの種別を取得
     TokenType getTokenType() { return Type; };
 
     // トークンの文字列表現を取得
-    std::string getTokenString() { return TokenString; };
+    // 必要になった時点で初めてstd::stringにコピーする
+    std::string getTokenString() { return TokenString.str(); };
+
+    // トークンの文字列をコピーせずに参照する
+    llvm::StringRef getTokenRef() { return TokenString; };
 
     // トークンの数値を取得
     int getNumberValue() { return Number; };
 
     // トークンの出現した行数を取得
-    int getLine() { return Line; };
+    uint64_t getLine() { return Line; };
 };
 
 /// TokenStreamクラス
-/// 切り出したすべてのTokenの格納と読み出し
+/// 切り出したTokenの格納と読み出し
+/// トークンごとにオブジェクトを確保せず、種別、ソース上の位置と長さ、
+/// 値を並列の配列(Struct of Arrays)に格納する
+/// Tokenが参照するソースバッファ(mmapされたファイル)も所有する
+///
+/// 字句解析はTokenStream自身が1トークンずつ行う
+/// - 一括モード(Window == 0): 構築時にすべてのトークンを切り出して保持する
+/// - ストリーミングモード(Window > 0): パーサが進むのに合わせて必要な分だけ切り出し、
+///   Window個のリングバッファに格納する 現在位置より後ろのトークンは再利用される
 class TokenStream {
     private:
-      std::vector<Token*> Tokens;
-      int CurIndex;
+      std::unique_ptr<llvm::MemoryBuffer> Source;
+      std::vector<unsigned char> Types;   // TokenType
+      std::vector<uint64_t> Offsets;      // ソース先頭からのオフセット
+      std::vector<uint32_t> Lengths;      // トークンの長さ
+      std::vector<int> Values;            // 数字は値、記号は文字コード、識別子はID
+      std::vector<uint64_t> LineStarts;   // 各行の先頭オフセット (一括モードのみ)
+      std::vector<uint64_t> Lines;        // トークンの行数 (ストリーミングモードのみ)
+      IdentifierTable Identifiers;        // 字句解析時に識別子へIDを割り当てる
+      TokenIndex CurIndex;
+      uint64_t RewindCount;               // インデックスを巻き戻した回数
+
+      // リングバッファ
+      TokenIndex Window;                  // 保持するトークン数 (0なら無制限)
+      TokenIndex Mask;                    // インデックスから格納位置を求めるマスク
+      TokenIndex Produced;                // 切り出し済みのトークン数
+
+      // 字句解析の状態
+      const char *LexCur;                 // 次に読む文字
+      uint64_t LexLine;                   // 現在の行数
+      bool LexEnd;                        // EOFトークンを切り出したか
+      bool LexError;                      // 解析不能字句があったか
+      const ScanKernel *Scan;             // 空白、識別子などを読み進める走査コア
+
+      // インデックスに対応する配列上の位置
+      TokenIndex slot(TokenIndex index) {
+          return index & Mask;
+      }
+
+      bool pushToken(TokenType type, uint64_t offset, uint32_t length, int value = 0x7fffffff);
+      bool pushLine(uint64_t offset);
+      bool lexToken();
 
     public:
-      TokenStream() : CurIndex(0){}
-      ~TokenStream();
+      TokenStream(std::unique_ptr<llvm::MemoryBuffer> source, TokenIndex window = 0);
+      ~TokenStream() {}
+
+      // ソースバッファの先頭と末尾を取得
+      const char *getSourceBegin() { return Source->getBufferStart(); }
+      const char *getSourceEnd() { return Source->getBufferEnd(); }
 
+      bool fill(TokenIndex index);
       bool ungetToken(int Times = 1);
       bool getNextToken();
-      bool pushToken(Token *token) {
-          Tokens.push_back(token);
-          return true;
-      }
       Token getToken();
 
       // トークンの種類を取得
       TokenType getCurType() {
-          return Tokens[CurIndex] -> getTokenType();
+          return (TokenType)Types[slot(CurIndex)];
+      }
+
+      // トークンの文字列をコピーせずに参照する
+      llvm::StringRef getCurRef() {
+          TokenIndex cur = slot(CurIndex);
+          return llvm::StringRef(getSourceBegin() + Offsets[cur], Lengths[cur]);
       }
 
       // トークンの文字列表現を取得
       std::string getCurString() {
-          return Tokens[CurIndex] -> getTokenString();
+          return getCurRef().str();
+      }
+
+      // 現在のトークンが記号symbolか判定する
+      bool isCurSymbol(char symbol) {
+          TokenIndex cur = slot(CurIndex);
+          return Types[cur] == TOK_SYMBOL && Values[cur] == symbol;
+      }
+
+      // 次のトークンが記号symbolか判定する (1トークン先読み)
+      bool isNextSymbol(char symbol) {
+          if (!fill(CurIndex + 1)) {
+              return false;
+          }
+          TokenIndex next = slot(CurIndex + 1);
+          return Types[next] == TOK_SYMBOL && Values[next] == symbol;
       }
 
       // トークンの数値を取得
       int getCurNumVal() {
-          return Tokens[CurIndex] -> getNumberValue();
+          return Values[slot(CurIndex)];
+      }
+
+      // 識別子トークンのIDを取得
+      int getCurIdent() {
+          return Values[slot(CurIndex)];
+      }
+
+      // 識別子表を取得
+      IdentifierTable &getIdentifiers() {
+          return Identifiers;
       }
 
       // 現在のインデックスを取得
-      int getCurIndex() {
+      TokenIndex getCurIndex() {
           return CurIndex;
       }
 
-      // インデックスを指定した値に設定
-      bool applyTokenIndex(int index) {
-          CurIndex = index;
-          return true;
+      bool applyTokenIndex(TokenIndex index);
+
+      // インデックスを巻き戻した回数を取得
+      uint64_t getRewindCount() {
+          return RewindCount;
       }
+
+      // 切り出し済みのトークン数を取得
+      TokenIndex size() {
+          return Produced;
+      }
+
+      // トークンの格納に確保しているバイト数を取得 (ソースは含まない)
+      size_t getMemorySize() {
+          return Types.capacity() * sizeof(unsigned char) + Offsets.capacity() * sizeof(uint64_t) +
+                 Lengths.capacity() * sizeof(uint32_t) + Values.capacity() * sizeof(int) +
+                 LineStarts.capacity() * sizeof(uint64_t) + Lines.capacity() * sizeof(uint64_t);
+      }
+
+      // ソースのバイト数を取得
+      size_t getSourceSize() { return Source->getBufferSize(); }
+
+      // 保持するトークン数を取得 (0ならすべて保持する)
+      TokenIndex getWindow() { return Window; }
+
+      // 解析不能字句があったか
+      bool hasError() {
+          return LexError;
+      }
+
+      uint64_t getLine(TokenIndex index);
       bool printTokens();
 };
 
-TokenStream *LexicalAnalysis(std::string input_filename);
+TokenStream *LexicalAnalysis(std::string input_filename, TokenIndex window = 0);
+TokenStream *LexicalAnalysis(std::unique_ptr<llvm::MemoryBuffer> source, TokenIndex window = 0);
 
-#endif
\ No newline at end of file
+#endif
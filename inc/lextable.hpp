@@ -0,0 +1,194 @@
+#ifndef LEXTABLE_HPP
+#define LEXTABLE_HPP
+
+#include<cstddef>
+#include<cstring>
+
+#include "lexer.hpp"
+
+// 字句解析の表
+// 文字クラス表、状態遷移表、予約語の完全ハッシュ表をconstexprでコンパイル時に作る
+// 記号や予約語を増やすときは下の定義を書き換えるだけでよく、lexTokenの分岐は増えない
+
+/// 1文字のトークンになる記号 ('/'はコメントの開始にもなるので別に扱う)
+static constexpr char LexSymbolChars[] = "*+-=;,(){}";
+
+/// 予約語
+struct LexKeyword {
+    const char *Name;
+    size_t Length;
+    TokenType Type;
+};
+static constexpr LexKeyword LexKeywords[] = {
+    { "int",    3, TOK_INT },
+    { "return", 6, TOK_RETURN },
+};
+static constexpr size_t LexKeywordNum = sizeof(LexKeywords) / sizeof(LexKeywords[0]);
+
+
+// S: 文字クラス
+
+/// 文字クラス
+enum LexCharClass {
+    CC_INVALID,   // 解析不能字句
+    CC_NEWLINE,   // '\n'
+    CC_SPACE,     // '\n'以外の空白
+    CC_ALPHA,     // 英字 (識別子の先頭)
+    CC_DIGIT,     // 数字
+    CC_SYMBOL,    // 1文字の記号
+    CC_SLASH,     // '/'
+    CC_STAR,      // '*' (記号でもあり、ブロックコメントの開始にもなる)
+    CC_EOF,       // 入力の終わり (表には現れない)
+    CC_CLASS_NUM,
+};
+
+struct LexCharClassTable {
+    unsigned char Classes[256];
+};
+
+constexpr LexCharClassTable makeLexCharClassTable() {
+    LexCharClassTable table = {};
+    for (int c = 0; c < 256; c++) {
+        table.Classes[c] = CC_INVALID;
+    }
+    for (int c = 'a'; c <= 'z'; c++) {
+        table.Classes[c] = CC_ALPHA;
+        table.Classes[c - 'a' + 'A'] = CC_ALPHA;
+    }
+    for (int c = '0'; c <= '9'; c++) {
+        table.Classes[c] = CC_DIGIT;
+    }
+    for (const char *s = " \t\v\f\r"; *s; s++) {
+        table.Classes[(unsigned char)*s] = CC_SPACE;
+    }
+    for (const char *s = LexSymbolChars; *s; s++) {
+        table.Classes[(unsigned char)*s] = CC_SYMBOL;
+    }
+    table.Classes['\n'] = CC_NEWLINE;
+    table.Classes['/'] = CC_SLASH;
+    table.Classes['*'] = CC_STAR;
+    return table;
+}
+
+static constexpr LexCharClassTable LexCharClasses = makeLexCharClassTable();
+
+
+// S: 状態遷移
+
+/// 状態
+enum LexState {
+    LS_START,     // トークンの先頭
+    LS_SLASH,     // '/'を読んだ直後
+    LS_STATE_NUM,
+};
+
+/// 遷移したときの動作
+enum LexAction {
+    LA_ERROR,          // 解析不能字句
+    LA_NEWLINE,        // 行テーブルに登録
+    LA_SPACE,          // 空白を読み飛ばす
+    LA_IDENTIFIER,     // 識別子または予約語
+    LA_NUMBER,         // 数字
+    LA_SYMBOL,         // 1文字の記号
+    LA_SLASH,          // LS_SLASHへ
+    LA_LINE_COMMENT,   // 行末までのコメント
+    LA_BLOCK_COMMENT,  // "*/"までのコメント
+    LA_DIVIDE,         // '/'だけで除算演算子 (次の文字は読まない)
+};
+
+struct LexTransitionTable {
+    unsigned char Actions[LS_STATE_NUM][CC_CLASS_NUM];
+};
+
+constexpr LexTransitionTable makeLexTransitionTable() {
+    LexTransitionTable table = {};
+    for (int c = 0; c < CC_CLASS_NUM; c++) {
+        table.Actions[LS_START][c] = LA_ERROR;
+        table.Actions[LS_SLASH][c] = LA_DIVIDE;
+    }
+    table.Actions[LS_START][CC_NEWLINE] = LA_NEWLINE;
+    table.Actions[LS_START][CC_SPACE] = LA_SPACE;
+    table.Actions[LS_START][CC_ALPHA] = LA_IDENTIFIER;
+    table.Actions[LS_START][CC_DIGIT] = LA_NUMBER;
+    table.Actions[LS_START][CC_SYMBOL] = LA_SYMBOL;
+    table.Actions[LS_START][CC_STAR] = LA_SYMBOL;
+    table.Actions[LS_START][CC_SLASH] = LA_SLASH;
+    table.Actions[LS_SLASH][CC_SLASH] = LA_LINE_COMMENT;
+    table.Actions[LS_SLASH][CC_STAR] = LA_BLOCK_COMMENT;
+    return table;
+}
+
+static constexpr LexTransitionTable LexTransitions = makeLexTransitionTable();
+
+
+// S: 予約語の完全ハッシュ
+// 先頭と末尾の文字と長さからハッシュを求め、予約語どうしが衝突しない係数をコンパイル時に探す
+// 表の各位置には予約語が高々1つなので、照合は1回の比較で済む
+
+/// 表の大きさ (予約語の数の2倍以上の2のべき乗)
+constexpr size_t lexKeywordTableSize() {
+    size_t size = 1;
+    while (size < LexKeywordNum * 2) {
+        size <<= 1;
+    }
+    return size;
+}
+static constexpr size_t LexKeywordTableSize = lexKeywordTableSize();
+
+constexpr size_t lexKeywordHash(unsigned seed, unsigned char first, unsigned char last, size_t length) {
+    return ((first * seed) ^ (last * 31u) ^ length) & (LexKeywordTableSize - 1);
+}
+
+/// 予約語が衝突しない係数を探す (見つからなければ0)
+constexpr unsigned findLexKeywordSeed() {
+    for (unsigned seed = 1; seed < 65536; seed++) {
+        bool used[LexKeywordTableSize] = {};
+        bool collided = false;
+        for (size_t i = 0; i < LexKeywordNum && !collided; i++) {
+            const LexKeyword &keyword = LexKeywords[i];
+            size_t hash = lexKeywordHash(seed, keyword.Name[0], keyword.Name[keyword.Length - 1], keyword.Length);
+            collided = used[hash];
+            used[hash] = true;
+        }
+        if (!collided) {
+            return seed;
+        }
+    }
+    return 0;
+}
+static constexpr unsigned LexKeywordSeed = findLexKeywordSeed();
+static_assert(LexKeywordSeed != 0, "予約語の完全ハッシュの係数が見つからない");
+
+struct LexKeywordTable {
+    LexKeyword Slots[LexKeywordTableSize];
+};
+
+constexpr LexKeywordTable makeLexKeywordTable() {
+    // 空きの位置は長さ0 (識別子は1文字以上なので一致しない)
+    LexKeywordTable table = {};
+    for (size_t i = 0; i < LexKeywordTableSize; i++) {
+        table.Slots[i] = LexKeyword{ "", 0, TOK_IDENTIFIER };
+    }
+    for (size_t i = 0; i < LexKeywordNum; i++) {
+        const LexKeyword &keyword = LexKeywords[i];
+        table.Slots[lexKeywordHash(LexKeywordSeed, keyword.Name[0], keyword.Name[keyword.Length - 1],
+                                   keyword.Length)] = keyword;
+    }
+    return table;
+}
+
+static constexpr LexKeywordTable LexKeywordSlots = makeLexKeywordTable();
+
+/// 識別子を予約語として引く
+/// @param 識別子の先頭 長さ(1以上)
+/// @return 予約語ならそのトークン種別、それ以外はTOK_IDENTIFIER
+inline TokenType lookupLexKeyword(const char *name, size_t length) {
+    const LexKeyword &slot = LexKeywordSlots.Slots[
+        lexKeywordHash(LexKeywordSeed, name[0], name[length - 1], length)];
+    if (slot.Length == length && memcmp(slot.Name, name, length) == 0) {
+        return slot.Type;
+    }
+    return TOK_IDENTIFIER;
+}
+
+#endif
@@ -0,0 +1,74 @@
+#ifndef MEMSTATS_HPP
+#define MEMSTATS_HPP
+
+#include<cstdio>
+#include<string>
+#include<vector>
+#include<sys/resource.h>
+#include<unistd.h>
+#include<llvm/IR/Module.h>
+#include<llvm/Support/FileSystem.h>
+#include<llvm/Support/JSON.h>
+#include<llvm/Support/raw_ostream.h>
+
+#include "app.hpp"
+#include "ast.hpp"
+
+/// メモリ使用量の統計クラス (--mem-stats)
+/// トークン、AST、識別子表、Moduleの大きさと、フェーズの区切りごとのRSSを記録する
+/// 記録した内容はテキストまたはJSONで出力する
+class MemoryStats {
+    private:
+        // フェーズの区切りで測ったRSS
+        struct PhaseSample {
+            std::string Name;
+            uint64_t RSS;       // その時点のRSS (バイト)
+            uint64_t PeakRSS;   // その時点までの最大RSS (バイト)
+        };
+
+        // 件数とバイト数
+        struct Entry {
+            std::string Name;
+            uint64_t Count;
+            uint64_t Bytes;
+        };
+
+        // Moduleの大きさ
+        struct ModuleSample {
+            std::string Name;
+            uint64_t Functions;
+            uint64_t Blocks;
+            uint64_t Instructions;
+        };
+
+        std::string InputName;
+        std::vector<PhaseSample> Phases;
+        uint64_t TokenCount;
+        uint64_t TokenBytes;
+        uint64_t SourceBytes;
+        uint64_t TokenWindow;
+        std::vector<Entry> Nodes;       // ASTのノード AstIDごと
+        uint64_t ArenaAllocated;
+        uint64_t ArenaReserved;
+        std::vector<Entry> Symbols;     // 識別子表
+        std::vector<ModuleSample> Modules;
+
+    public:
+        MemoryStats(std::string input_name)
+            : InputName(input_name), TokenCount(0), TokenBytes(0), SourceBytes(0), TokenWindow(0),
+              ArenaAllocated(0), ArenaReserved(0) {}
+        ~MemoryStats() {}
+        void samplePhase(std::string name);
+        void recordTokens(uint64_t count, uint64_t bytes, uint64_t source_bytes, uint64_t window);
+        void recordSymbolTable(std::string name, uint64_t entries, uint64_t bytes);
+        void recordAST(TranslationUnitAST &tunit);
+        void recordModule(std::string name, llvm::Module &mod);
+        bool printText(FILE *out);
+        bool writeJSON(std::string filename);
+
+    private:
+        void countNode(BaseAST *node);
+        void addNode(unsigned index, uint64_t bytes);
+};
+
+#endif
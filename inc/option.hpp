@@ -0,0 +1,82 @@
+#ifndef OPTION_HPP
+#define OPTION_HPP
+
+#include<cstdint>
+#include<cstdio>
+#include<cstdlib>
+#include<cstring>
+#include<string>
+#include<vector>
+
+#include "app.hpp"
+
+/// 出力形式
+enum OutputKind {
+    OUTPUT_IR,    // LLVM-IR(テキスト)
+    OUTPUT_BC,    // LLVM-IR(Bitcode)
+    OUTPUT_ASM,   // アセンブリ
+    OUTPUT_OBJ,   // オブジェクトファイル
+    OUTPUT_EXE,   // 実行ファイル(ランタイムをリンクする)
+};
+
+/// 引数のオプション切り出しクラス
+/// LLVMに依存しないので、dcc-clientも同じクラスで引数を解釈する
+class OptionParser {
+    private:
+        std::vector<std::string> InputFilenames;
+        std::string OutputFilename;
+        bool ArenaStats;
+        uint64_t TokenWindow;
+        unsigned Jobs;
+        bool Run;
+        OutputKind Kind;
+        unsigned OptLevel;
+        std::string Passes;
+        bool NoRuntime;
+        bool NoSimplify;
+        bool SimplifyStats;
+        bool DirectSSA;
+        std::string ServeSocket;
+        std::string CacheDir;
+        uint64_t CacheMaxSize;
+        bool CacheStats;
+        bool TimeReport;
+        std::string TracePath;
+        bool MemStats;
+        std::string MemStatsPath;
+        int Argc;
+        char **Argv;
+
+    public:
+        OptionParser(int argc, char **argv):ArenaStats(false), TokenWindow(0), Jobs(1), Run(false), Kind(OUTPUT_IR), OptLevel(0), NoRuntime(false), NoSimplify(false), SimplifyStats(false), DirectSSA(false), CacheMaxSize(256 << 20), CacheStats(false), TimeReport(false), MemStats(false), Argc(argc), Argv(argv) {}
+        void printHelp() {
+            // ヘルプ表示
+            fprintf(stdout, "Compiler for DummyC...\n");
+        }
+        std::string getInputFileName() { return InputFilenames.empty() ? std::string() : InputFilenames[0]; } // 入力ファイル名の取得
+        std::vector<std::string> &getInputFileNames() { return InputFilenames; } // 全入力ファイル名の取得
+        std::string getOutputFileName() { return getOutputFileName(getInputFileName()); } // 出力ファイル名の取得
+        std::string getOutputFileName(std::string input_filename); // 入力ファイルに対応する出力ファイル名の取得
+        bool getArenaStats() { return ArenaStats; } // Arenaの統計を表示するか
+        uint64_t getTokenWindow() { return TokenWindow; } // 保持するトークン数(TokenIndex) (0なら一括)
+        unsigned getJobs() { return Jobs; } // 並列数 (コード生成、複数ファイルのコンパイル、サーバのワーカ)
+        bool getRun() { return Run; } // 出力せずにJIT実行するか
+        OutputKind getOutputKind() { return Kind; } // 出力形式
+        unsigned getOptLevel() { return OptLevel; } // 最適化レベル
+        std::string getPasses() { return Passes; } // 最適化パイプライン (空なら最適化レベルに従う)
+        bool getNoRuntime() { return NoRuntime; } // ランタイムをリンクせず宣言のままにするか
+        bool getNoSimplify() { return NoSimplify; } // ASTの簡約(定数の畳み込みなど)を行わないか
+        bool getSimplifyStats() { return SimplifyStats; } // ASTの簡約で取り除いた節点の数を表示するか
+        bool getDirectSSA() { return DirectSSA; } // allocaとmem2regを使わずSSA形式を直接生成するか
+        std::string getServeSocket() { return ServeSocket; } // コンパイルサーバのソケット (空なら通常のコンパイル)
+        std::string getCacheDir() { return CacheDir; } // コンパイルキャッシュのディレクトリ (空ならキャッシュしない)
+        uint64_t getCacheMaxSize() { return CacheMaxSize; } // コンパイルキャッシュの合計サイズの上限
+        bool getCacheStats() { return CacheStats; } // コンパイルキャッシュの統計を表示するか
+        bool getTimeReport() { return TimeReport; } // フェーズごと、関数ごとの時間を表示するか
+        std::string getTracePath() { return TracePath; } // time-traceの出力先 (空なら記録しない)
+        bool getMemStats() { return MemStats; } // メモリ使用量の統計を表示するか
+        std::string getMemStatsPath() { return MemStatsPath; } // メモリ使用量の統計のJSONの出力先 (空ならテキストで表示)
+        bool parseOption(); // オプション切り出しメソッド
+};
+
+#endif
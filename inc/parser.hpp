@@ -1,13 +1,21 @@
+#ifndef PARSER_HPP
+#define PARSER_HPP
+
 #include "ast.hpp"
 #include "app.hpp"
+#include "arena.hpp"
 #include "lexer.hpp"
+#include "memstats.hpp"
+#include "timing.hpp"
 
 #include<string>
 #include<vector>
 #include<map>
 #include<algorithm>
+#include<cassert>
 #include<cstdio>
 #include<cstdlib>
+#include<llvm/ADT/SmallVector.h>
 
 // S: 構文解析クラスの実装 p.80
 
@@ -21,32 +29,53 @@ class Parser {
         TranslationUnitAST *TU;
 
         //意味解析用各種識別子表
-        // 解析中の関数の変数名を登録しておくベクタ
-        std::vector<std::string> VariableTable;
-        //
-        std::map<std::string, int> PrototypeTable;
-        //
-        std::map<std::string, int> FunctionTable;
+        // いずれも字句解析で割り当てた識別子IDを添字にして引く
+        // 変数が宣言された関数の番号 (CurFuncNumと一致すれば解析中の関数で宣言済み)
+        std::vector<int> VariableTable;
+        // 変数の関数内での番号 (VariableTableが解析中の関数を指すときだけ有効)
+        std::vector<int> VariableSlots;
+        // 解析中の関数の番号 関数ごとに増やすことでVariableTableをクリアせずに済ませる
+        int CurFuncNum;
+        // プロトタイプ宣言された関数の引数の数 (未宣言は-1)
+        std::vector<int> PrototypeTable;
+        // 定義された関数の引数の数 (未定義は-1)
+        std::vector<int> FunctionTable;
+        // 関数の番号 (プロトタイプ宣言と関数定義で共通、未割り当ては-1)
+        std::vector<int> FunctionIndexTable;
+        // 識別子IDごとにArenaへコピーした名前
+        std::vector<llvm::StringRef> IdentNames;
+        // 関数ごとの時間の計測 (NULLなら計測しない)
+        TimeReport *Timing;
 
     public:
-        Parser(std::string filename);
+        Parser(std::string filename, TokenIndex token_window = 0);
+        Parser(std::unique_ptr<llvm::MemoryBuffer> source, TokenIndex token_window = 0);
         ~Parser() {SAFE_DELETE(TU); SAFE_DELETE(Tokens);}
 
         // 構文解析開始トリガ
         // 外部から呼び出し、解析の成否を真偽値で返す
         bool doParse();
 
+        // TokenStreamを巻き戻した回数
+        uint64_t getRewindCount();
+
         // 解析結果ASTを外部から取得する
         // TranslationUnitASTはASTの頂点
         TranslationUnitAST &getAST();
 
+        // トークンと識別子表の大きさをメモリ統計に記録する
+        bool reportMemory(MemoryStats &stats);
+
+        // 関数ごとの構文解析時間を計測する
+        void setTimeReport(TimeReport *timing) { Timing = timing; }
+
     private:
         // 各解析メソッドの命名規則: visit<非終端記号名>
         // 返り値は基本的に解析して得られたASTクラス型のポインタ
         bool visitTranslationUnit();
         bool visitExternalDeclaration(TranslationUnitAST *tunit);
-        PrototypeAST *visitFunctionDeclaration();
-        FunctionAST *visitFunctionDefinition();
+        bool visitFunctionDeclaration(PrototypeAST *proto);
+        FunctionAST *visitFunctionDefinition(PrototypeAST *proto);
         PrototypeAST *visitPrototype();
         FunctionStmtAST *visitFunctionStatement(PrototypeAST *proto);
         VariableDeclAST *visitVariableDeclaration();
@@ -54,10 +83,23 @@ class Parser {
         BaseAST *visitExpressionStatement();
         BaseAST *visitJumpStatement();
         BaseAST *visitAssignmentExpression();
-        BaseAST *visitAdditiveExpression(BaseAST *lhs);
-        BaseAST *visitMultiplicativeExpression(BaseAST *lhs);
+        BaseAST *visitBinaryExpression(int min_prec);
         BaseAST *visitPostfixExpression();
         BaseAST *visitPrimaryExpression();
+
+        // 現在のトークンの二項演算子としての優先順位
+        int getBinaryPrecedence();
+
+        // 識別子表の操作
+        llvm::StringRef getIdentName(int id);
+        bool isDeclaredVariable(int id);
+        bool declareVariable(int id, int slot);
+        int lookupVariableSlot(int id);
+        int getFunctionIndex(int id);
+        int lookupSymbol(std::vector<int> &table, int id);
+        bool registerSymbol(std::vector<int> &table, int id, int param_num);
 };
 
 // E: 構文解析クラスの実装 p.80
+
+#endif
@@ -0,0 +1,102 @@
+#ifndef PROTOCOL_HPP
+#define PROTOCOL_HPP
+
+#include<cerrno>
+#include<cstdint>
+#include<string>
+#include<sys/socket.h>
+#include<unistd.h>
+
+/// コンパイルサーバとクライアントの間の通信形式
+/// Unixドメインソケットで同じホスト上だけで通信するので、整数はホストのバイト順で送る
+///
+/// リクエスト: u32 引数の数, (u32 長さ, 引数)*, u64 ソースの長さ, ソース
+///             引数の数が0のリクエストはサーバの停止を表す
+/// レスポンス: i32 終了ステータス, u32 フラグ, u32 長さ, 出力ファイル名, u64 長さ, 出力,
+///             u64 長さ, 診断メッセージ (dccなら標準エラーに出るもの)
+///
+/// 1つの接続で複数のリクエストを順に送ってよい
+/// 長さが上限を超えるフレームは領域を確保する前に不正として扱い、接続を閉じる
+
+// フレームの大きさの上限 (壊れたフレームの長さで巨大な領域を確保しないため)
+const uint32_t ProtocolMaxArgs = 4096;           // 引数の数
+const uint32_t ProtocolMaxString = 64 << 10;     // 引数、出力ファイル名の長さ
+const uint64_t ProtocolMaxBlob = 1ULL << 30;     // ソース、出力の長さ
+
+// レスポンスのフラグ
+enum ResponseFlag {
+    RESPONSE_EXECUTABLE = 1,   // 出力は実行ファイル
+};
+
+/// 指定したバイト数をすべて書き込む
+/// 相手が先に接続を閉じてもSIGPIPEでプロセスごと終了しないよう、MSG_NOSIGNALで送り
+/// EPIPEは他の失敗と同じくfalseを返す (呼び出し側はその接続だけを閉じる)
+/// @param ソケット データ バイト数
+/// @return 成功時: true, 失敗時: false
+inline bool writeFully(int fd, const void *data, size_t size) {
+    const char *cur = static_cast<const char*>(data);
+    while (size > 0) {
+        ssize_t written = send(fd, cur, size, MSG_NOSIGNAL);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        } else if (written <= 0) {
+            return false;
+        }
+        cur += written;
+        size -= written;
+    }
+    return true;
+}
+
+/// 指定したバイト数をすべて読み込む
+/// @param ファイル記述子 データ バイト数
+/// @return 成功時: true, 失敗時(途中で接続が切れた場合を含む): false
+inline bool readFully(int fd, void *data, size_t size) {
+    char *cur = static_cast<char*>(data);
+    while (size > 0) {
+        ssize_t got = read(fd, cur, size);
+        if (got < 0 && errno == EINTR) {
+            continue;
+        } else if (got <= 0) {
+            return false;
+        }
+        cur += got;
+        size -= got;
+    }
+    return true;
+}
+
+/// 長さ(u32)付きの文字列を書き込む
+inline bool writeString(int fd, const std::string &str) {
+    uint32_t size = str.size();
+    return writeFully(fd, &size, sizeof(size)) && writeFully(fd, str.data(), size);
+}
+
+/// 長さ(u32)付きの文字列を読み込む
+/// @return 成功時: true, 失敗時(長さがProtocolMaxStringを超える場合を含む): false
+inline bool readString(int fd, std::string &str) {
+    uint32_t size;
+    if (!readFully(fd, &size, sizeof(size)) || size > ProtocolMaxString) {
+        return false;
+    }
+    str.resize(size);
+    return size == 0 || readFully(fd, &str[0], size);
+}
+
+/// 長さ(u64)付きのデータを書き込む
+inline bool writeBlob(int fd, const char *data, uint64_t size) {
+    return writeFully(fd, &size, sizeof(size)) && (size == 0 || writeFully(fd, data, size));
+}
+
+/// 長さ(u64)付きのデータを読み込む
+/// @return 成功時: true, 失敗時(長さがProtocolMaxBlobを超える場合を含む): false
+inline bool readBlob(int fd, std::string &blob) {
+    uint64_t size;
+    if (!readFully(fd, &size, sizeof(size)) || size > ProtocolMaxBlob) {
+        return false;
+    }
+    blob.resize(size);
+    return size == 0 || readFully(fd, &blob[0], size);
+}
+
+#endif
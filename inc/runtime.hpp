@@ -0,0 +1,11 @@
+#ifndef RUNTIME_HPP
+#define RUNTIME_HPP
+
+#include<llvm/ADT/StringRef.h>
+
+/// dccに埋め込んだランタイム(lib/printnum.c)のBitcodeを取得する
+/// ビルド時にBitcodeへコンパイルし、.incbinでdccの読み出し専用データに埋め込む
+/// @return Bitcodeの先頭から末尾までを指すStringRef
+llvm::StringRef getRuntimeBitcode();
+
+#endif
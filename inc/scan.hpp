@@ -0,0 +1,51 @@
+#ifndef SCAN_HPP
+#define SCAN_HPP
+
+#include<cstddef>
+
+#include "app.hpp"
+
+// 字句解析の走査コア
+// 空白の読み飛ばし、識別子/数字の終端、改行とコメント終端("*/")の検索を
+// 16/32バイト単位でまとめて行う
+// SSE2/AVX2版は実行時にCPUの機能を調べて選び、x86以外ではスカラー版を使う
+
+/// 文字の分類 (ロケールに依存しないASCIIの分類)
+/// 改行は行テーブルに登録する必要があるので空白に含めない
+inline bool isScanSpace(char c) {
+    return c == ' ' || (c >= '\t' && c <= '\r' && c != '\n');
+}
+inline bool isScanDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+inline bool isScanAlpha(char c) {
+    return (unsigned char)((c | 0x20) - 'a') < 26;
+}
+inline bool isScanAlnum(char c) {
+    return isScanAlpha(c) || isScanDigit(c);
+}
+
+/// 走査関数の組
+/// いずれも[cur, end)を走査し、条件を満たす最初の位置(なければend)を返す
+struct ScanKernel {
+    const char *Name;
+    const char *(*SkipSpaces)(const char *cur, const char *end);        // 空白(改行以外)でない文字
+    const char *(*FindIdentifierEnd)(const char *cur, const char *end); // 英数字でない文字
+    const char *(*FindDigitEnd)(const char *cur, const char *end);      // 数字でない文字
+    const char *(*FindNewline)(const char *cur, const char *end);       // '\n'
+    const char *(*FindCommentEnd)(const char *cur, const char *end);    // "*/"の'*'
+};
+
+/// 走査コアの種類
+enum ScanKernelKind {
+    SCAN_SCALAR,
+    SCAN_SSE2,
+    SCAN_AVX2,
+    SCAN_KIND_NUM,
+};
+
+const ScanKernel *getScanKernel(ScanKernelKind kind);
+const ScanKernel *getActiveScanKernel();
+void setActiveScanKernel(const ScanKernel *kernel);
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef SERVER_HPP
+#define SERVER_HPP
+
+#include<condition_variable>
+#include<cstdio>
+#include<cstdlib>
+#include<deque>
+#include<mutex>
+#include<string>
+#include<thread>
+#include<vector>
+#include<sys/socket.h>
+#include<sys/un.h>
+#include<unistd.h>
+#include<llvm/Support/MemoryBuffer.h>
+
+#include "app.hpp"
+#include "driver.hpp"
+#include "option.hpp"
+#include "protocol.hpp"
+
+/// コンパイルサーバクラス
+/// Unixドメインソケットで接続を受け付け、ワーカスレッドのプールでコンパイルする
+/// ワーカはそれぞれDriverを持ち、TargetMachine、最適化パイプライン、
+/// 読み込み済みのランタイムをリクエスト間で使い回す
+class CompileServer {
+    private:
+        std::string SocketPath;
+        unsigned WorkerNum;
+        std::string RuntimePath;
+        int ListenFd;
+
+        // 受け付けた接続の待ち行列
+        std::deque<int> Pending;
+        std::mutex Lock;
+        std::condition_variable Ready;
+        bool Stopping;
+
+    public:
+        CompileServer(std::string socket_path, unsigned worker_num, std::string runtime_path)
+            : SocketPath(socket_path), WorkerNum(worker_num), RuntimePath(runtime_path),
+              ListenFd(-1), Stopping(false) {}
+        ~CompileServer() {}
+        int run();
+
+    private:
+        void workerLoop();
+        bool handleRequest(Driver &driver, int fd);
+        void stop();
+};
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef SIMPLIFY_HPP
+#define SIMPLIFY_HPP
+
+#include<cstdint>
+#include<cstdio>
+#include<llvm/ADT/StringRef.h>
+#include<llvm/Support/Casting.h>
+
+#include "app.hpp"
+#include "ast.hpp"
+
+/// ASTの簡約クラス
+/// 構文解析とコード生成の間で関数本体の式を書き換え、コード生成する節点を減らす
+/// - 定数どうしの演算を畳み込む (32bitで折り返す IRのadd/sub/mulと同じ結果になる)
+/// - x+0, 0+x, x-0, x*1, 1*x, x/1 を x に、副作用のない x*0, 0*x を 0 にする
+/// - (x+c1)+c2, (x-c1)+c2, (x*c1)*c2 のような定数の連鎖を1つの定数にまとめる
+/// 0除算とINT_MIN/-1はIRでは未定義動作になるので畳み込まず、そのまま残す
+/// 新しい節点はTranslationUnitASTのArenaに確保し、元の節点は解放しない
+class ASTSimplifier {
+    private:
+        TranslationUnitAST &TU;
+        uint64_t Removed;       // 取り除いた節点の数
+        uint64_t Folded;        // 畳み込んだ定数どうしの演算の数
+        uint64_t Identities;    // 恒等式で取り除いた演算の数
+        uint64_t Reassociated;  // まとめた定数の連鎖の数
+
+    public:
+        ASTSimplifier(TranslationUnitAST &tunit)
+            : TU(tunit), Removed(0), Folded(0), Identities(0), Reassociated(0) {}
+        ~ASTSimplifier() {}
+        bool doSimplify();
+        uint64_t getRemovedNodes() { return Removed; }
+        bool printStats(FILE *out);
+
+    private:
+        void simplifyFunction(FunctionStmtAST *body);
+        BaseAST *simplifyExpression(BaseAST *expr);
+        BaseAST *simplifyBinaryExpression(BinaryExprAST *bin_expr);
+        BaseAST *simplifyAdditive(BinaryExprAST *bin_expr, int rhs);
+        BaseAST *simplifyMultiplicative(BinaryExprAST *bin_expr, int rhs);
+        NumberAST *createNumber(int value);
+        static bool evaluate(llvm::StringRef op, int lhs, int rhs, int &result);
+        static bool hasSideEffects(BaseAST *expr);
+        static uint64_t countNodes(BaseAST *expr);
+};
+
+#endif
@@ -0,0 +1,75 @@
+#ifndef TIMING_HPP
+#define TIMING_HPP
+
+#include<deque>
+#include<mutex>
+#include<string>
+#include<llvm/ADT/StringRef.h>
+#include<llvm/Support/TimeProfiler.h>
+#include<llvm/Support/Timer.h>
+#include<llvm/Support/raw_ostream.h>
+
+#include "app.hpp"
+
+// time-traceに記録する区間の最小の長さ(マイクロ秒) 関数ごとの区間も残すよう0にする
+static const unsigned TraceGranularity = 0;
+
+/// コンパイル時間の計測クラス (--time-report)
+/// フェーズごとの時間と、関数ごとの構文解析、コード生成の時間をLLVMのTimerで測る
+/// 関数ごとのTimerは並列コード生成のワーカからも作られるので、作成だけを排他する
+class TimeReport {
+    public:
+        enum Phase {
+            PHASE_LEX,        // 字句解析(一括字句解析のみ ストリーミングでは構文解析に含まれる)
+            PHASE_PARSE,      // 構文解析
+            PHASE_SIMPLIFY,   // ASTの簡約
+            PHASE_CODEGEN,    // コード生成
+            PHASE_RUNTIME,    // ランタイムのリンク
+            PHASE_OPTIMIZE,   // 最適化
+            PHASE_OUTPUT,     // ファイル出力
+            PHASE_NUM
+        };
+
+    private:
+        // TimerGroupはTimerより先に宣言する(Timerが先に破棄されるように)
+        llvm::TimerGroup PhaseGroup;
+        llvm::TimerGroup ParseGroup;
+        llvm::TimerGroup CodeGenGroup;
+        llvm::Timer Phases[PHASE_NUM];
+        std::deque<llvm::Timer> FunctionTimers;
+        std::mutex Lock;
+
+    public:
+        TimeReport();
+        ~TimeReport() {}
+        llvm::Timer *getPhaseTimer(Phase phase) { return &Phases[phase]; }
+        llvm::Timer *createParseTimer(llvm::StringRef name);
+        llvm::Timer *createCodeGenTimer(llvm::StringRef name);
+        void print(llvm::raw_ostream &out);
+
+        // 計測しない場合(reportがNULL)はNULLを返す
+        static llvm::Timer *getPhaseTimer(TimeReport *report, Phase phase) {
+            return report ? report->getPhaseTimer(phase) : NULL;
+        }
+        static llvm::Timer *createParseTimer(TimeReport *report, llvm::StringRef name) {
+            return report ? report->createParseTimer(name) : NULL;
+        }
+        static llvm::Timer *createCodeGenTimer(TimeReport *report, llvm::StringRef name) {
+            return report ? report->createCodeGenTimer(name) : NULL;
+        }
+};
+
+/// 計測区間
+/// Timer(--time-report)とtime-traceプロファイラ(--trace)の両方に区間を記録する
+/// TimerがNULLでプロファイラも無効なら何もしない
+class TimeScope {
+    private:
+        llvm::TimeRegion Region;
+        llvm::TimeTraceScope Trace;
+
+    public:
+        TimeScope(llvm::Timer *timer, llvm::StringRef name, llvm::StringRef detail = llvm::StringRef())
+            : Region(timer), Trace(name, detail) {}
+};
+
+#endif
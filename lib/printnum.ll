@@ -0,0 +1,12 @@
+; lib/printnum.cと同じ内容のLLVM-IR
+; clangがない環境でdccに埋め込むランタイムのBitcodeを作るために使う
+
+@.str = private unnamed_addr constant [4 x i8] c"%d\0A\00", align 1
+
+define i32 @printnum(i32 %i) {
+entry:
+  %call = call i32 (i8*, ...) @printf(i8* getelementptr inbounds ([4 x i8], [4 x i8]* @.str, i64 0, i64 0), i32 %i)
+  ret i32 %call
+}
+
+declare i32 @printf(i8*, ...)
@@ -7,7 +7,7 @@ target triple = "x86_64-pc-linux-gnu"
 
 define i32 @test(i32 %j_arg) {
 entry:
-  %mul_tmp = mul i32 10, %j_arg
+  %mul_tmp = mul i32 %j_arg, 10
   ret i32 %mul_tmp
 }
 
@@ -5,7 +5,7 @@ declare i32 @printnum(i32)
 
 define i32 @test(i32 %j_arg) {
 entry:
-  %mul_tmp = mul i32 10, %j_arg
+  %mul_tmp = mul i32 %j_arg, 10
   ret i32 %mul_tmp
 }
 
@@ -1,16 +1,11 @@
 #include "ast.hpp"
 
+/// デストラクタ
+/// 配下のASTはArenaごと一括して解放する
 TranslationUnitAST::~TranslationUnitAST() {
-    // プロトタイプの数分
-    for (int i = 0; i < Prototypes.size(); i++) {
-        SAFE_DELETE(Prototypes[i]);
-    }
     Prototypes.clear();
-
-    for (int i = 0; i < Functions.size(); i++) {
-        SAFE_DELETE(Functions[i]);
-    }
     Functions.clear();
+    Nodes.release();
 }
 
 /// PrototypeAST(関数宣言追加メソッド)
@@ -36,39 +31,3 @@ bool TranslationUnitAST::empty() {
         return false;
     }
 }
-
-/// デストラクタ
-FunctionAST::~FunctionAST(){
-    SAFE_DELETE(Proto);
-    SAFE_DELETE(Body);
-}
-
-/// デストラクタ
-FunctionStmtAST::~FunctionStmtAST() {
-    // delete variable declaration
-    for (int i = 0; i < VariableDecls.size(); i++) {
-        SAFE_DELETE(VariableDecls[i]);
-    }
-    VariableDecls.clear();
-
-    // delete statements
-    for (int i = 0; i < StmtLists.size(); i++) {
-        SAFE_DELETE(StmtLists[i]);
-    }
-    StmtLists.clear();
-}
-
-/// VariableDeclAST(変数宣言追加)メソッド
-/// @param VariableDeclAST
-/// @return true
-bool FunctionStmtAST::addVariableDeclaration(VariableDeclAST *vdecl) {
-    VariableDecls.push_back(vdecl);
-    return true;
-}
-
-/// デストラクタ
-CallExprAST::~CallExprAST() {
-    for (int i = 0; i < Args.size(); i++) {
-        SAFE_DELETE(Args[i]);
-    }
-}
\ No newline at end of file
@@ -0,0 +1,67 @@
+// BatchCompilerクラスのメソッドを実装していく
+
+#include "batch.hpp"
+
+#include<algorithm>
+
+/// 一括コンパイルの実行
+/// 出力ファイル名は入力ファイルごとに決める
+/// @return 終了ステータス (1つでも失敗すれば1)
+int BatchCompiler::run() {
+    std::vector<std::string> &inputs = Opt.getInputFileNames();
+    Status.assign(inputs.size(), 1);
+    Next = 0;
+
+    // ファイル数より多くのワーカは作らない
+    unsigned worker_num = std::max(1u, std::min(WorkerNum, (unsigned)inputs.size()));
+    std::vector<std::thread> workers;
+    for (unsigned i = 0; i < worker_num; i++) {
+        workers.push_back(std::thread(&BatchCompiler::workerLoop, this));
+    }
+    for (size_t i = 0; i < workers.size(); i++) {
+        workers[i].join();
+    }
+
+    size_t failed = 0;
+    for (size_t i = 0; i < Status.size(); i++) {
+        if (Status[i] != 0) {
+            failed++;
+        }
+    }
+    if (failed > 0) {
+        fprintf(stderr, "%zu of %zu files failed\n", failed, inputs.size());
+        return 1;
+    }
+    return 0;
+}
+
+/// ワーカスレッド
+/// 入力ファイルを1つずつ取り出してコンパイルする
+/// ファイル単位で並列化するので、関数単位の並列コード生成は使わない
+void BatchCompiler::workerLoop() {
+    // time-traceプロファイラはスレッドごとに有効にする
+    bool trace = !Opt.getTracePath().empty();
+    if (trace) {
+        llvm::timeTraceProfilerInitialize(TraceGranularity, "dcc");
+    }
+
+    std::vector<std::string> &inputs = Opt.getInputFileNames();
+    {
+        Driver driver(RuntimePath);
+        while (true) {
+            size_t index = Next++;
+            if (index >= inputs.size()) {
+                break;
+            }
+            TimeScope scope(NULL, "Compile", inputs[index]);
+            Status[index] = driver.compileFile(Opt, inputs[index], 1);
+            if (Status[index] != 0) {
+                fprintf(stderr, "%s: compilation failed\n", inputs[index].c_str());
+            }
+        }
+    }
+
+    if (trace) {
+        llvm::timeTraceProfilerFinishThread();
+    }
+}
@@ -0,0 +1,512 @@
+// コンパイラのスループット計測 (dcc-bench)
+// SourceGeneratorで生成したプログラムを各フェーズに通し、
+// 字句解析/構文解析のトークン毎秒、コード生成/最適化の関数毎秒をJSONで出力する
+// 1つの軸だけを変えて計測するので、規模に対して線形でないフェーズは曲線として現れる
+//
+// usage: dcc-bench [--functions=N] [--locals=N] [--statements=N] [--depth=N] [--fan-out=N]
+//                  [--sweep=<axis>:v1,v2,...] [--repeat=N] [-O<level>] [--no-simplify] [--ssa]
+//                  [-o result.json]
+//        dcc-bench [大きさの指定] --emit-source=<file>
+//        dcc-bench --lexer [--lexer-bytes=N] [--repeat=N] [-o result.json]
+//          字句解析の走査コア(scalar/sse2/avx2)ごとに、入力の種類別の処理速度を比べる
+
+#include<cstdio>
+#include<cstdlib>
+#include<cstring>
+#include<string>
+#include<vector>
+#include<llvm/ADT/StringRef.h>
+#include<llvm/Support/FileSystem.h>
+#include<llvm/Support/JSON.h>
+#include<llvm/Support/MemoryBuffer.h>
+#include<llvm/Support/TargetSelect.h>
+#include<llvm/Support/Timer.h>
+#include<llvm/Support/raw_ostream.h>
+
+#include "codegen.hpp"
+#include "emitter.hpp"
+#include "generator.hpp"
+#include "lexer.hpp"
+#include "parser.hpp"
+#include "scan.hpp"
+#include "simplify.hpp"
+
+/// 変化させる軸と値の列
+struct SweepAxis {
+    std::string Name;
+    std::vector<unsigned> Values;
+};
+
+/// 1回の計測結果
+struct BenchResult {
+    std::string Axis;
+    unsigned Value;
+    size_t SourceBytes;
+    size_t Tokens;
+    size_t Functions;
+    double LexTime;
+    double ParseTime;
+    double SimplifyTime;
+    uint64_t RemovedNodes;
+    double CodeGenTime;
+    double OptimizeTime;
+};
+
+/// 現在のウォールクロック時間を取得する
+static double now() {
+    return llvm::TimeRecord::getCurrentTime(true).getWallTime();
+}
+
+/// 軸の名前に対応する設定項目を取得する
+/// @param 設定 軸の名前
+/// @return 設定項目 名前が不正ならNULL
+static unsigned *getAxis(GeneratorConfig &config, llvm::StringRef name) {
+    if (name == "functions") {
+        return &config.Functions;
+    } else if (name == "locals") {
+        return &config.Locals;
+    } else if (name == "statements") {
+        return &config.Statements;
+    } else if (name == "depth") {
+        return &config.Depth;
+    } else if (name == "fan-out") {
+        return &config.FanOut;
+    }
+    return NULL;
+}
+
+/// --sweep=<axis>:v1,v2,... を解析する
+/// @param 引数の値 解析結果
+/// @return 成功時: true, 失敗時: false
+static bool parseSweep(llvm::StringRef arg, SweepAxis &axis) {
+    std::pair<llvm::StringRef, llvm::StringRef> name_values = arg.split(':');
+    GeneratorConfig dummy;
+    if (!getAxis(dummy, name_values.first) || name_values.second.empty()) {
+        return false;
+    }
+    axis.Name = name_values.first.str();
+    llvm::SmallVector<llvm::StringRef, 8> values;
+    name_values.second.split(values, ',');
+    for (size_t i = 0; i < values.size(); i++) {
+        unsigned value;
+        if (values[i].getAsInteger(10, value)) {
+            return false;
+        }
+        axis.Values.push_back(value);
+    }
+    return true;
+}
+
+/// 生成したプログラムを各フェーズに通して時間を計る
+/// 繰り返した中で最も短い時間を採用する
+/// コード生成の時間にはmem2reg(直接SSA構築では不要)を含む
+/// @param ソース 最適化レベル ASTの簡約をするか 直接SSA構築か 繰り返し回数 結果
+/// @return 成功時: true, 失敗時: false
+static bool measure(const std::string &source, unsigned opt_level, bool simplify, bool direct_ssa,
+                    unsigned repeat, BenchResult &result) {
+    result.SourceBytes = source.size();
+    result.LexTime = result.ParseTime = result.SimplifyTime = result.CodeGenTime = result.OptimizeTime = 1e30;
+    result.RemovedNodes = 0;
+    Emitter emitter("");
+    if (!emitter.isValid()) {
+        return false;
+    }
+
+    for (unsigned r = 0; r < repeat; r++) {
+        // 字句解析
+        double start = now();
+        TokenStream *tokens = LexicalAnalysis(llvm::MemoryBuffer::getMemBufferCopy(source, "bench.dc"));
+        double lex_time = now() - start;
+        if (!tokens) {
+            fprintf(stderr, "error at lexer\n");
+            return false;
+        }
+        result.Tokens = tokens->size();
+        SAFE_DELETE(tokens);
+
+        // 構文解析 (Parserの生成時に行う字句解析は含めない)
+        Parser *parser = new Parser(llvm::MemoryBuffer::getMemBufferCopy(source, "bench.dc"));
+        start = now();
+        bool parsed = parser->doParse();
+        double parse_time = now() - start;
+        if (!parsed) {
+            SAFE_DELETE(parser);
+            return false;
+        }
+
+        // ASTの簡約
+        double simplify_time = 0;
+        if (simplify) {
+            ASTSimplifier simplifier(parser->getAST());
+            start = now();
+            simplifier.doSimplify();
+            simplify_time = now() - start;
+            result.RemovedNodes = simplifier.getRemovedNodes();
+        }
+
+        // コード生成
+        CodeGen *codegen = new CodeGen();
+        codegen->setDirectSSA(direct_ssa);
+        start = now();
+        bool generated = codegen->doCodeGen(parser->getAST(), "bench.dc");
+        double codegen_time = now() - start;
+        SAFE_DELETE(parser);
+        if (!generated) {
+            SAFE_DELETE(codegen);
+            return false;
+        }
+        llvm::Module &mod = codegen->getModule();
+        result.Functions = 0;
+        for (llvm::Function &func : mod) {
+            if (!func.isDeclaration()) {
+                result.Functions++;
+            }
+        }
+
+        // 最適化パイプライン
+        start = now();
+        bool optimized = emitter.optimizeModule(mod, opt_level, "");
+        double optimize_time = now() - start;
+        SAFE_DELETE(codegen);
+        if (!optimized) {
+            return false;
+        }
+
+        result.LexTime = std::min(result.LexTime, lex_time);
+        result.ParseTime = std::min(result.ParseTime, parse_time);
+        result.SimplifyTime = std::min(result.SimplifyTime, simplify_time);
+        result.CodeGenTime = std::min(result.CodeGenTime, codegen_time);
+        result.OptimizeTime = std::min(result.OptimizeTime, optimize_time);
+    }
+    return true;
+}
+
+/// 字句解析のマイクロベンチマークの結果
+struct LexerResult {
+    std::string Input;
+    std::string Kernel;
+    std::string Mode;   // lexer: LexicalAnalysis全体, scan: 走査コアだけ
+    size_t Bytes;
+    size_t Tokens;
+    double Time;
+    double Speedup;     // 同じModeのスカラー版に対する速度比
+};
+
+/// 走査コアだけで入力を読み進め、トークンの数を数える
+/// トークンの格納や識別子の登録を含まないので、走査コアの差がそのまま現れる
+/// @param 走査コア 入力 行数の格納先
+/// @return トークンの数
+static size_t scanOnly(const ScanKernel *kernel, const std::string &input, uint64_t &lines) {
+    const char *cur = input.data();
+    const char *end = cur + input.size();
+    size_t tokens = 0;
+    lines = 0;
+    while (cur < end) {
+        char c = *cur++;
+        if (c == '\n') {
+            lines++;
+            continue;
+        } else if (isScanSpace(c)) {
+            cur = kernel->SkipSpaces(cur, end);
+            continue;
+        } else if (isScanAlpha(c)) {
+            cur = kernel->FindIdentifierEnd(cur, end);
+        } else if (isScanDigit(c)) {
+            cur = kernel->FindDigitEnd(cur, end);
+        } else if (c == '/' && cur < end && *cur == '/') {
+            cur = kernel->FindNewline(cur, end);
+            continue;
+        } else if (c == '/' && cur < end && *cur == '*') {
+            const char *close = kernel->FindCommentEnd(cur + 1, end);
+            for (const char *newline = kernel->FindNewline(cur + 1, close); newline < close;
+                 newline = kernel->FindNewline(newline + 1, close)) {
+                lines++;
+            }
+            cur = (close < end) ? close + 2 : end;
+            continue;
+        }
+        tokens++;
+    }
+    return tokens;
+}
+
+/// 走査コアを切り替えて字句解析の時間を計る
+/// どの走査コアでも同じトークン列になることも確認する
+/// @param 入力のバイト数 繰り返し回数 結果
+/// @return 成功時: true, 失敗時: false
+static bool measureLexer(size_t bytes, unsigned repeat, std::vector<LexerResult> &results) {
+    for (int input_kind = 0; input_kind < LEXER_INPUT_KIND_NUM; input_kind++) {
+        std::string input = generateLexerInput((LexerInputKind)input_kind, bytes);
+        double scalar_time[2] = { 0, 0 };
+        size_t scalar_tokens = 0;
+        uint64_t scalar_last = 0;
+        for (int kernel_kind = 0; kernel_kind < SCAN_KIND_NUM; kernel_kind++) {
+            const ScanKernel *kernel = getScanKernel((ScanKernelKind)kernel_kind);
+            if (!kernel) {
+                continue;
+            }
+            setActiveScanKernel(kernel);
+
+            for (int mode = 0; mode < 2; mode++) {
+                LexerResult result;
+                result.Input = getLexerInputName((LexerInputKind)input_kind);
+                result.Kernel = kernel->Name;
+                result.Mode = mode == 0 ? "lexer" : "scan";
+                result.Bytes = input.size();
+                result.Time = 1e30;
+                for (unsigned r = 0; r < repeat; r++) {
+                    double start = now();
+                    if (mode == 1) {
+                        uint64_t lines;
+                        result.Tokens = scanOnly(kernel, input, lines);
+                        result.Time = std::min(result.Time, now() - start);
+                        continue;
+                    }
+                    TokenStream *tokens = LexicalAnalysis(llvm::MemoryBuffer::getMemBufferCopy(input, "lexer.dc"));
+                    double time = now() - start;
+                    if (!tokens) {
+                        setActiveScanKernel(NULL);
+                        return false;
+                    }
+                    result.Tokens = tokens->size();
+                    uint64_t last = tokens->getLine(tokens->size() - 1);
+                    SAFE_DELETE(tokens);
+                    result.Time = std::min(result.Time, time);
+
+                    if (kernel_kind == SCAN_SCALAR) {
+                        scalar_tokens = result.Tokens;
+                        scalar_last = last;
+                    } else if (result.Tokens != scalar_tokens || last != scalar_last) {
+                        fprintf(stderr, "%s: %s gives %zu tokens (line %llu), scalar gives %zu (line %llu)\n",
+                                result.Input.c_str(), kernel->Name, result.Tokens, (unsigned long long)last,
+                                scalar_tokens, (unsigned long long)scalar_last);
+                        setActiveScanKernel(NULL);
+                        return false;
+                    }
+                }
+                if (kernel_kind == SCAN_SCALAR) {
+                    scalar_time[mode] = result.Time;
+                }
+                result.Speedup = result.Time > 0 ? scalar_time[mode] / result.Time : 0;
+                fprintf(stderr, "%-10s %-6s %-5s: %8.1f MB/s (x%.2f)\n", result.Input.c_str(), kernel->Name,
+                        result.Mode.c_str(), result.Bytes / result.Time / 1e6, result.Speedup);
+                results.push_back(result);
+            }
+        }
+    }
+    setActiveScanKernel(NULL);
+    return true;
+}
+
+/// 時間あたりの件数を取得する
+static double rate(size_t count, double seconds) {
+    return seconds > 0 ? count / seconds : 0;
+}
+
+/// 計測結果をJSONで書き出す
+/// @param 出力先 基準の設定 最適化レベル 直接SSA構築か 繰り返し回数 計測結果
+static void writeResults(llvm::raw_ostream &out, const GeneratorConfig &base, unsigned opt_level,
+                         bool direct_ssa, unsigned repeat, const std::vector<BenchResult> &results) {
+    llvm::json::OStream json(out, 2);
+    json.object([&] {
+        json.attributeObject("base", [&] {
+            json.attribute("functions", (int64_t)base.Functions);
+            json.attribute("locals", (int64_t)base.Locals);
+            json.attribute("statements", (int64_t)base.Statements);
+            json.attribute("depth", (int64_t)base.Depth);
+            json.attribute("fan_out", (int64_t)base.FanOut);
+        });
+        json.attribute("opt_level", (int64_t)opt_level);
+        json.attribute("codegen", direct_ssa ? "ssa" : "alloca");
+        json.attribute("repeat", (int64_t)repeat);
+        json.attributeArray("results", [&] {
+            for (size_t i = 0; i < results.size(); i++) {
+                const BenchResult &r = results[i];
+                json.object([&] {
+                    json.attribute("axis", r.Axis);
+                    json.attribute("value", (int64_t)r.Value);
+                    json.attribute("source_bytes", (int64_t)r.SourceBytes);
+                    json.attribute("tokens", (int64_t)r.Tokens);
+                    json.attribute("functions", (int64_t)r.Functions);
+                    json.attribute("lex_seconds", r.LexTime);
+                    json.attribute("lex_tokens_per_sec", rate(r.Tokens, r.LexTime));
+                    json.attribute("parse_seconds", r.ParseTime);
+                    json.attribute("parse_tokens_per_sec", rate(r.Tokens, r.ParseTime));
+                    json.attribute("simplify_seconds", r.SimplifyTime);
+                    json.attribute("simplify_removed_nodes", (int64_t)r.RemovedNodes);
+                    json.attribute("codegen_seconds", r.CodeGenTime);
+                    json.attribute("codegen_functions_per_sec", rate(r.Functions, r.CodeGenTime));
+                    json.attribute("optimize_seconds", r.OptimizeTime);
+                    json.attribute("optimize_functions_per_sec", rate(r.Functions, r.OptimizeTime));
+                });
+            }
+        });
+    });
+    out << "\n";
+}
+
+/// 字句解析のマイクロベンチマークの結果をJSONで書き出す
+/// @param 出力先 繰り返し回数 計測結果
+static void writeLexerResults(llvm::raw_ostream &out, unsigned repeat, const std::vector<LexerResult> &results) {
+    llvm::json::OStream json(out, 2);
+    json.object([&] {
+        json.attribute("active_kernel", getActiveScanKernel()->Name);
+        json.attribute("repeat", (int64_t)repeat);
+        json.attributeArray("lexer", [&] {
+            for (size_t i = 0; i < results.size(); i++) {
+                const LexerResult &r = results[i];
+                json.object([&] {
+                    json.attribute("input", r.Input);
+                    json.attribute("kernel", r.Kernel);
+                    json.attribute("mode", r.Mode);
+                    json.attribute("bytes", (int64_t)r.Bytes);
+                    json.attribute("tokens", (int64_t)r.Tokens);
+                    json.attribute("seconds", r.Time);
+                    json.attribute("bytes_per_sec", rate(r.Bytes, r.Time));
+                    json.attribute("tokens_per_sec", rate(r.Tokens, r.Time));
+                    json.attribute("speedup", r.Speedup);
+                });
+            }
+        });
+    });
+    out << "\n";
+}
+
+int main(int argc, char **argv) {
+    llvm::InitializeNativeTarget();
+    llvm::InitializeNativeTargetAsmPrinter();
+
+    GeneratorConfig base;
+    std::vector<SweepAxis> sweeps;
+    unsigned opt_level = 2;
+    unsigned repeat = 3;
+    std::string output = "-";
+    std::string emit_source;
+    bool lexer = false;
+    bool simplify = true;
+    bool direct_ssa = false;
+    unsigned lexer_bytes = 16 << 20;
+
+    for (int i = 1; i < argc; i++) {
+        llvm::StringRef arg(argv[i]);
+        std::pair<llvm::StringRef, llvm::StringRef> name_value = arg.split('=');
+        unsigned *axis = NULL;
+        if (arg.startswith("--") && (axis = getAxis(base, name_value.first.drop_front(2)))) {
+            if (name_value.second.getAsInteger(10, *axis)) {
+                fprintf(stderr, "%s の値が不正です\n", argv[i]);
+                return 1;
+            }
+        } else if (name_value.first == "--sweep") {
+            SweepAxis sweep;
+            if (!parseSweep(name_value.second, sweep)) {
+                fprintf(stderr, "%s の指定が不正です (--sweep=<axis>:v1,v2,...)\n", argv[i]);
+                return 1;
+            }
+            sweeps.push_back(sweep);
+        } else if (name_value.first == "--repeat") {
+            if (name_value.second.getAsInteger(10, repeat) || repeat == 0) {
+                fprintf(stderr, "%s の値が不正です\n", argv[i]);
+                return 1;
+            }
+        } else if (name_value.first == "--seed") {
+            if (name_value.second.getAsInteger(10, base.Seed)) {
+                fprintf(stderr, "%s の値が不正です\n", argv[i]);
+                return 1;
+            }
+        } else if (arg == "--no-simplify") {
+            simplify = false;
+        } else if (arg == "--ssa") {
+            direct_ssa = true;
+        } else if (arg == "--lexer") {
+            lexer = true;
+        } else if (name_value.first == "--lexer-bytes") {
+            if (name_value.second.getAsInteger(10, lexer_bytes) || lexer_bytes == 0) {
+                fprintf(stderr, "%s の値が不正です\n", argv[i]);
+                return 1;
+            }
+        } else if (name_value.first == "--emit-source") {
+            emit_source = name_value.second.str();
+        } else if (arg.size() == 3 && arg.startswith("-O") && arg[2] >= '0' && arg[2] <= '3') {
+            opt_level = arg[2] - '0';
+        } else if (arg == "-o" && i + 1 < argc) {
+            output = argv[++i];
+        } else {
+            fprintf(stderr, "不明なオプションです: %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    // 生成したプログラムを書き出すだけ
+    if (!emit_source.empty()) {
+        std::error_code ec;
+        llvm::raw_fd_ostream stream(emit_source, ec, llvm::sys::fs::OF_Text);
+        if (ec) {
+            fprintf(stderr, "%s: %s\n", emit_source.c_str(), ec.message().c_str());
+            return 1;
+        }
+        stream << SourceGenerator(base).generate();
+        return 0;
+    }
+
+    // 字句解析の走査コアの比較
+    if (lexer) {
+        std::vector<LexerResult> results;
+        if (!measureLexer(lexer_bytes, repeat, results)) {
+            fprintf(stderr, "failed at lexer benchmark\n");
+            return 1;
+        }
+        std::error_code ec;
+        llvm::raw_fd_ostream stream(output, ec, llvm::sys::fs::OF_Text);
+        if (ec) {
+            fprintf(stderr, "%s: %s\n", output.c_str(), ec.message().c_str());
+            return 1;
+        }
+        writeLexerResults(stream, repeat, results);
+        return 0;
+    }
+
+    // 軸の指定がなければすべての軸を基準の前後で変化させる
+    if (sweeps.empty()) {
+        const char *defaults[] = {
+            "functions:100,200,400,800,1600,3200",
+            "locals:1,4,16,64,256",
+            "statements:2,8,32,128",
+            "depth:1,4,16,64",
+            "fan-out:0,2,8,32",
+        };
+        for (size_t i = 0; i < sizeof(defaults) / sizeof(defaults[0]); i++) {
+            SweepAxis sweep;
+            parseSweep(defaults[i], sweep);
+            sweeps.push_back(sweep);
+        }
+    }
+
+    std::vector<BenchResult> results;
+    for (size_t s = 0; s < sweeps.size(); s++) {
+        for (size_t v = 0; v < sweeps[s].Values.size(); v++) {
+            GeneratorConfig config = base;
+            *getAxis(config, sweeps[s].Name) = sweeps[s].Values[v];
+
+            BenchResult result;
+            result.Axis = sweeps[s].Name;
+            result.Value = sweeps[s].Values[v];
+            if (!measure(SourceGenerator(config).generate(), opt_level, simplify, direct_ssa, repeat, result)) {
+                fprintf(stderr, "failed at %s=%u\n", result.Axis.c_str(), result.Value);
+                return 1;
+            }
+            fprintf(stderr, "%-10s %6u: lex %.3fs parse %.3fs simplify %.3fs codegen %.3fs optimize %.3fs\n",
+                    result.Axis.c_str(), result.Value, result.LexTime, result.ParseTime,
+                    result.SimplifyTime, result.CodeGenTime, result.OptimizeTime);
+            results.push_back(result);
+        }
+    }
+
+    std::error_code ec;
+    llvm::raw_fd_ostream stream(output, ec, llvm::sys::fs::OF_Text);
+    if (ec) {
+        fprintf(stderr, "%s: %s\n", output.c_str(), ec.message().c_str());
+        return 1;
+    }
+    writeResults(stream, base, opt_level, direct_ssa, repeat, results);
+    return 0;
+}
@@ -0,0 +1,179 @@
+// CompileCacheクラスのメソッドを実装していく
+
+#include "cache.hpp"
+
+// キーの形式 キーに含める項目を変えたら上げる (古いエントリはヒットしなくなりLRUで消える)
+static const char *CacheKeyFormat = "key-v3";
+
+/// キャッシュのキーを計算する
+/// 最適化後のModuleに影響するものだけを含め、-jや--streamのように結果が変わらないものは含めない
+/// Module名(入力ファイル名)と出力形式はエントリから出力するときに決まるので含めない
+/// DCC_VERSIONの更新漏れに備えて、パスやBitcodeを変えるLLVMのバージョンも含める
+/// @param オプション ソースのバイト列
+/// @return キー(SHA1の16進文字列)
+std::string CompileCache::computeKey(OptionParser &opt, llvm::StringRef source) {
+    llvm::SHA1 hasher;
+    hasher.update(CacheKeyFormat);
+    hasher.update(llvm::StringRef("", 1));
+    hasher.update("dcc " DCC_VERSION);
+    hasher.update(llvm::StringRef("", 1));
+    hasher.update("LLVM " LLVM_VERSION_STRING);
+    hasher.update(llvm::StringRef("", 1));
+    hasher.update(llvm::sys::getDefaultTargetTriple());
+    hasher.update(llvm::StringRef("", 1));
+
+    uint8_t flags[] = {(uint8_t)opt.getOptLevel(), (uint8_t)opt.getNoRuntime(),
+                       (uint8_t)opt.getNoSimplify(), (uint8_t)opt.getDirectSSA()};
+    hasher.update(llvm::ArrayRef<uint8_t>(flags, sizeof(flags)));
+    hasher.update(opt.getPasses());
+    hasher.update(llvm::StringRef("", 1));
+
+    // 埋め込んだランタイムが変わればリンク結果も変わる
+    if (!opt.getNoRuntime()) {
+        hasher.update(getRuntimeBitcode());
+    }
+    hasher.update(source);
+    return llvm::toHex(hasher.final(), true);
+}
+
+/// キャッシュのエントリのパスを取得
+/// pruneCacheは"llvmcache-"で始まるファイルだけを削除の対象にする
+/// @param キー
+/// @return パス
+std::string CompileCache::getEntryPath(std::string key) {
+    llvm::SmallString<128> path(Dir);
+    llvm::sys::path::append(path, "llvmcache-" + key);
+    return path.str().str();
+}
+
+/// キャッシュを引く
+/// ヒットしたエントリは最終アクセス時刻を更新してLRUの順序に反映する
+/// @param キー
+/// @return ヒット時: 出力のバイト列, ミス時: NULL
+std::unique_ptr<llvm::MemoryBuffer> CompileCache::lookup(std::string key) {
+    std::string path = getEntryPath(key);
+    int fd;
+    if (llvm::sys::fs::openFileForRead(path, fd)) {
+        updateStats(0, 1, NULL, NULL);
+        return NULL;
+    }
+    llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer> > buffer =
+        llvm::MemoryBuffer::getOpenFile(fd, path, -1);
+    llvm::sys::fs::setLastAccessAndModificationTime(fd, std::chrono::system_clock::now());
+    close(fd);
+    if (!buffer) {
+        updateStats(0, 1, NULL, NULL);
+        return NULL;
+    }
+    updateStats(1, 0, NULL, NULL);
+    return std::move(*buffer);
+}
+
+/// キャッシュに出力を保存する
+/// 同じディレクトリの一時ファイルに書いてからrenameし、その後で上限を超えた分を削除する
+/// @param キー 出力のバイト列
+/// @return 成功時: true, 失敗時: false
+bool CompileCache::store(std::string key, llvm::StringRef data) {
+    if (llvm::sys::fs::create_directories(Dir)) {
+        fprintf(diagStream(), "failed to create cache directory %s\n", Dir.c_str());
+        return false;
+    }
+
+    llvm::SmallString<128> model(Dir);
+    llvm::sys::path::append(model, "tmp-%%%%%%%%");
+    llvm::Expected<llvm::sys::fs::TempFile> temp = llvm::sys::fs::TempFile::create(model);
+    if (!temp) {
+        fprintf(diagStream(), "failed to create cache entry: %s\n", llvm::toString(temp.takeError()).c_str());
+        return false;
+    }
+    {
+        llvm::raw_fd_ostream stream(temp->FD, false);
+        stream << data;
+    }
+    if (llvm::Error err = temp->keep(getEntryPath(key))) {
+        fprintf(diagStream(), "failed to store cache entry: %s\n", llvm::toString(std::move(err)).c_str());
+        return false;
+    }
+
+    // 期限切れやディスク空き容量による削除は行わず、合計サイズの上限だけで削除する
+    llvm::CachePruningPolicy policy;
+    policy.Interval = std::chrono::seconds(0);
+    policy.Expiration = std::chrono::seconds(0);
+    policy.MaxSizePercentageOfAvailableSpace = 0;
+    policy.MaxSizeBytes = MaxSize;
+    llvm::pruneCache(Dir, policy);
+    return true;
+}
+
+/// statsファイルのヒット数とミス数に加算する
+/// 複数のdccが同時に更新するのでファイルをロックして読み書きする
+/// @param 加算するヒット数 加算するミス数 加算後のヒット数 加算後のミス数(不要ならNULL)
+/// @return 成功時: true, 失敗時: false
+bool CompileCache::updateStats(uint64_t hits, uint64_t misses, uint64_t *total_hits, uint64_t *total_misses) {
+    if (llvm::sys::fs::create_directories(Dir)) {
+        return false;
+    }
+    llvm::SmallString<128> path(Dir);
+    llvm::sys::path::append(path, "stats");
+    int fd = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    flock(fd, LOCK_EX);
+
+    char buf[128] = {};
+    unsigned long long cur_hits = 0, cur_misses = 0;
+    if (pread(fd, buf, sizeof(buf) - 1, 0) > 0) {
+        sscanf(buf, "hits %llu misses %llu", &cur_hits, &cur_misses);
+    }
+    cur_hits += hits;
+    cur_misses += misses;
+    if (hits != 0 || misses != 0) {
+        int len = snprintf(buf, sizeof(buf), "hits %llu misses %llu\n", cur_hits, cur_misses);
+        if (ftruncate(fd, 0) != 0 || pwrite(fd, buf, len, 0) != len) {
+            fprintf(diagStream(), "failed to update cache stats\n");
+        }
+    }
+
+    flock(fd, LOCK_UN);
+    close(fd);
+    if (total_hits) {
+        *total_hits = cur_hits;
+    }
+    if (total_misses) {
+        *total_misses = cur_misses;
+    }
+    return true;
+}
+
+/// キャッシュの統計を表示する
+/// @param 出力先
+/// @return 成功時: true, 失敗時: false
+bool CompileCache::printStats(FILE *out) {
+    uint64_t hits = 0, misses = 0;
+    if (!updateStats(0, 0, &hits, &misses)) {
+        fprintf(diagStream(), "failed to read cache stats in %s\n", Dir.c_str());
+        return false;
+    }
+
+    uint64_t entries = 0, bytes = 0;
+    std::error_code ec;
+    for (llvm::sys::fs::directory_iterator it(Dir, ec), end; it != end && !ec; it.increment(ec)) {
+        if (!llvm::sys::path::filename(it->path()).startswith("llvmcache-")) {
+            continue;
+        }
+        llvm::ErrorOr<llvm::sys::fs::basic_file_status> status = it->status();
+        if (status) {
+            entries++;
+            bytes += status->getSize();
+        }
+    }
+
+    uint64_t lookups = hits + misses;
+    fprintf(out, "cache %s: %llu entries, %llu bytes (limit %llu bytes)\n", Dir.c_str(),
+            (unsigned long long)entries, (unsigned long long)bytes, (unsigned long long)MaxSize);
+    fprintf(out, "cache %s: %llu hits, %llu misses, %.1f%% hit rate\n", Dir.c_str(),
+            (unsigned long long)hits, (unsigned long long)misses,
+            lookups ? 100.0 * hits / lookups : 0.0);
+    return true;
+}
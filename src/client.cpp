@@ -0,0 +1,147 @@
+// コンパイルサーバのクライアント (dcc-client)
+// LLVMをリンクしない小さなプログラムとして、起動のコストを抑える
+// 引数の解釈はLLVMに依存しないOptionParserをdccと共有する
+//
+// usage: dcc-client <socket> [dccのオプション] file.dc
+//        dcc-client <socket> --shutdown
+
+#include<cstdio>
+#include<cstring>
+#include<string>
+#include<vector>
+#include<sys/socket.h>
+#include<sys/stat.h>
+#include<sys/un.h>
+#include<unistd.h>
+
+#include "option.hpp"
+#include "protocol.hpp"
+
+/// ファイルの内容を読み込む
+/// @param ファイル名 読み込み先
+/// @return 成功時: true, 失敗時: false
+static bool readFile(const char *filename, std::string &data) {
+    FILE *fp = fopen(filename, "rb");
+    if (!fp) {
+        return false;
+    }
+    char buf[65536];
+    size_t got;
+    while ((got = fread(buf, 1, sizeof(buf), fp)) > 0) {
+        data.append(buf, got);
+    }
+    bool result = !ferror(fp);
+    fclose(fp);
+    return result;
+}
+
+/// ファイルに書き出す
+/// @param ファイル名 データ 実行ファイルか
+/// @return 成功時: true, 失敗時: false
+static bool writeFile(const std::string &filename, const std::string &data, bool executable) {
+    FILE *fp = fopen(filename.c_str(), "wb");
+    if (!fp) {
+        return false;
+    }
+    bool result = fwrite(data.data(), 1, data.size(), fp) == data.size();
+    result = (fclose(fp) == 0) && result;
+    if (result && executable) {
+        chmod(filename.c_str(), 0755);
+    }
+    return result;
+}
+
+/// サーバに接続する
+/// @param ソケットのパス
+/// @return ソケット 失敗時は-1
+static int connectServer(const char *socket_path) {
+    sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    if (strlen(socket_path) >= sizeof(addr.sun_path)) {
+        return -1;
+    }
+    strcpy(addr.sun_path, socket_path);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    if (connect(fd, (sockaddr*)&addr, sizeof(addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 3) {
+        fprintf(stderr, "usage: %s <socket> [options] file.dc\n", argv[0]);
+        return 1;
+    }
+    int fd = connectServer(argv[1]);
+    if (fd < 0) {
+        fprintf(stderr, "cannot connect to %s\n", argv[1]);
+        return 1;
+    }
+
+    // サーバの停止
+    if (strcmp(argv[2], "--shutdown") == 0) {
+        uint32_t zero = 0;
+        bool result = writeFully(fd, &zero, sizeof(zero));
+        close(fd);
+        return result ? 0 : 1;
+    }
+
+    // 引数はdccと同じOptionParserで解釈し、誤りはサーバに送る前にここで報告する
+    // (argv[0]の代わりにソケットのパスを読み飛ばさせる)
+    OptionParser opt(argc - 1, argv + 1);
+    if (!opt.parseOption()) {
+        close(fd);
+        return 1;
+    }
+    if (opt.getInputFileNames().size() != 1) {
+        fprintf(stderr, "入力ファイルは1つだけ指定してください\n");
+        close(fd);
+        return 1;
+    }
+    std::string source;
+    if (!readFile(opt.getInputFileName().c_str(), source)) {
+        fprintf(stderr, "cannot read %s\n", opt.getInputFileName().c_str());
+        close(fd);
+        return 1;
+    }
+
+    // リクエスト
+    uint32_t arg_num = argc - 2;
+    bool sent = writeFully(fd, &arg_num, sizeof(arg_num));
+    for (int i = 2; sent && i < argc; i++) {
+        sent = writeString(fd, argv[i]);
+    }
+    sent = sent && writeBlob(fd, source.data(), source.size());
+
+    // レスポンス
+    int32_t status;
+    uint32_t flags;
+    std::string output_name, output, diag;
+    if (!sent ||
+        !readFully(fd, &status, sizeof(status)) ||
+        !readFully(fd, &flags, sizeof(flags)) ||
+        !readString(fd, output_name) ||
+        !readBlob(fd, output) ||
+        !readBlob(fd, diag)) {
+        fprintf(stderr, "connection to server is lost\n");
+        close(fd);
+        return 1;
+    }
+    close(fd);
+
+    // サーバで出た診断メッセージはdccと同じく標準エラーに出す
+    fwrite(diag.data(), 1, diag.size(), stderr);
+    if (status != 0) {
+        return status;
+    }
+    if (!writeFile(output_name, output, flags & RESPONSE_EXECUTABLE)) {
+        fprintf(stderr, "cannot write %s\n", output_name.c_str());
+        return 1;
+    }
+    return 0;
+}
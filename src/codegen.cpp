@@ -11,19 +11,33 @@ CodeGen::CodeGen() {
     // llvmContextはgetGlobalContext()でコンテキストが得られる
     Builder = new llvm::IRBuilder<>(context);
     Mod = NULL;
+    Runtime = NULL;
+    Timing = NULL;
+    DirectSSA = false;
 }
 
 /// デストラクタ
 CodeGen::~CodeGen() {
     SAFE_DELETE(Builder);
     SAFE_DELETE(Mod);
+    SAFE_DELETE(Runtime);
 }
 
 /// コード生成実行
-/// @param TranslationUnitAST Module名(入力ファイル名)
+/// 同じCodeGenで続けて呼び出した場合、前回のModuleは破棄する
+/// @param TranslationUnitAST Module名(入力ファイル名) 並列数
 /// @return 成功時: True, 失敗時: false
-bool CodeGen::doCodeGen(TranslationUnitAST &tunit, std::string name) {
-    return generateTranslationUnit(tunit, name);
+bool CodeGen::doCodeGen(TranslationUnitAST &tunit, std::string name, unsigned jobs) {
+    SAFE_DELETE(Mod);
+    CurFunc = NULL;
+    if (jobs > 1 && tunit.getFunctionNum() > 1) {
+        return generateParallel(tunit, name, jobs);
+    }
+    if (!generateTranslationUnit(tunit, name)) {
+        return false;
+    }
+    resetValueNames(Mod);
+    return true;
 }
 
 /// モジュールの取得
@@ -36,36 +50,276 @@ llvm::Module &CodeGen::getModule() {
         return *(new llvm::Module("null", context));
 }
 
+/// モジュールの所有権の放棄
+/// ExecutionEngineなどModuleを所有する側へ渡すときに使う
+/// ModuleはこのCodeGenのコンテキストに属するので、CodeGenより先に解放すること
+/// @return 生成したModule 生成していなければNULL
+llvm::Module *CodeGen::releaseModule() {
+    llvm::Module *mod = Mod;
+    Mod = NULL;
+    return mod;
+}
+
+/// ランタイムのリンク
+/// dccに埋め込んだランタイムのBitcodeを読み込み、Moduleから参照される関数だけをリンクする
+/// リンクした関数は内部リンケージにして、最適化でインライン展開、特殊化できるようにする
+/// 読み込んだランタイムは保持しておき、同じCodeGenの次のModuleには複製をリンクする
+/// @return 成功時: true, 失敗時: false
+bool CodeGen::linkRuntime() {
+    if (!Mod) {
+        return false;
+    }
+
+    // parseIRはBitcodeとテキストのどちらも読み込める
+    if (!Runtime) {
+        llvm::SMDiagnostic err;
+        std::unique_ptr<llvm::Module> parsed = llvm::parseIR(
+            llvm::MemoryBufferRef(getRuntimeBitcode(), "runtime"), err, context);
+        if (!parsed) {
+            fprintf(diagStream(), "failed to read runtime: %s\n", err.getMessage().str().c_str());
+            return false;
+        }
+        Runtime = parsed.release();
+    }
+    std::unique_ptr<llvm::Module> runtime = llvm::CloneModule(*Runtime);
+    runtime->setTargetTriple(Mod->getTargetTriple());
+    runtime->setDataLayout(Mod->getDataLayout());
+
+    std::vector<std::string> runtime_funcs;
+    for (llvm::Function &func : *runtime) {
+        if (!func.isDeclaration()) {
+            runtime_funcs.push_back(func.getName().str());
+        }
+    }
+
+    if (llvm::Linker::linkModules(*Mod, std::move(runtime), llvm::Linker::Flags::LinkOnlyNeeded)) {
+        fprintf(diagStream(), "failed to link runtime\n");
+        return false;
+    }
+    for (size_t i = 0; i < runtime_funcs.size(); i++) {
+        llvm::Function *func = Mod->getFunction(runtime_funcs[i]);
+        if (func && !func->isDeclaration()) {
+            func->setLinkage(llvm::GlobalValue::InternalLinkage);
+        }
+    }
+    return true;
+}
+
 /// Module作成メソッド
 /// Moduleを生成し、内包する関数のプロトタイプ宣言と関数定義の生成メソッドを呼ぶ
 /// @param TranslationUnitAST Module名(入力ファイル名)
 /// @return 成功時: True, 失敗時: false
 bool CodeGen::generateTranslationUnit(TranslationUnitAST &tunit, std::string name) {
+    return generateFunctionRange(tunit, name, 0, tunit.getFunctionNum());
+}
+
+/// 関数定義の一部だけを含むModuleの作成
+/// 呼び出し先を解決できるようすべての関数を宣言してから、
+/// begin番目からend番目の手前までの関数定義を生成して最適化する
+/// @param TranslationUnitAST Module名(入力ファイル名) 生成する関数定義の範囲
+/// @return 成功時: True, 失敗時: false
+bool CodeGen::generateFunctionRange(TranslationUnitAST &tunit, std::string name, int begin, int end) {
     // llvm::Moduleのコンストラクタ: Module(StringRef ModuleID, LLVMContext &C)
     // - ModuleID モジュールの名前
     // - LLVMContext IRBuilderと同じコンテキストを使えばOK
     Mod = new llvm::Module(name, context);
 
     // Function declaration
-    for (int i = 0; ; i++) {
-        PrototypeAST *proto = tunit.getPrototype(i);
-        if (!proto) {
-            break;
-        } else if (!generatePrototype(proto, Mod)) {
+    if (!generateDeclarations(tunit, Mod)) {
+        SAFE_DELETE(Mod);
+        return false;
+    }
+
+    // function definition
+    for (int i = begin; i < end; i++) {
+        if (!generateFunctionDefinition(tunit.getFunction(i), Mod)) {
             SAFE_DELETE(Mod);
             return false;
         }
     }
+    return optimizeModule(Mod);
+}
 
-    // function definition
-    for (int i = 0; ; i++) {
-        FunctionAST *func = tunit.getFunction(i);
-        if (!func) {
-            break;
-        } else if (!(generateFunctionDefinition(func, Mod))) {
+/// 関数宣言をまとめて生成する
+/// プロトタイプ宣言、関数定義の順に宣言するので、
+/// どの範囲の関数定義を生成してもModule内の関数の並びは同じになる
+/// 宣言したFunctionは構文解析で割り当てた関数の番号で引けるようにしておく
+/// @param TranslationUnitAST Module
+/// @return 成功時: True, 失敗時: false
+bool CodeGen::generateDeclarations(TranslationUnitAST &tunit, llvm::Module *mod) {
+    Functions.assign(tunit.getFunctionIndexNum(), NULL);
+    for (int i = 0; i < tunit.getPrototypeNum(); i++) {
+        if (!generatePrototype(tunit.getPrototype(i), mod)) {
+            return false;
+        }
+    }
+    for (int i = 0; i < tunit.getFunctionNum(); i++) {
+        if (!generatePrototype(tunit.getFunction(i)->getPrototype(), mod)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/// 関数単位の最適化
+/// 関数ごとに独立したパスだけを使うので、分割したModuleごとに適用しても結果は変わらない
+/// 直接SSA構築ではallocaを生成しないので、mem2regは不要
+/// @param Module
+/// @return 成功時: True, 失敗時: false
+bool CodeGen::optimizeModule(llvm::Module *mod) {
+    if (DirectSSA) {
+        return true;
+    }
+    llvm::legacy::FunctionPassManager fpm(mod);
+
+    // mem2regをPassMangerに登録
+    fpm.add(llvm::createPromoteMemoryToRegisterPass());
+
+    fpm.doInitialization();
+    for (llvm::Function &func : *mod) {
+        if (!func.isDeclaration()) {
+            fpm.run(func);
+        }
+    }
+    fpm.doFinalization();
+    return true;
+}
+
+/// ModuleをBitcodeに書き出す
+/// コンテキストの異なるModuleへ渡すために使う 参照されていない宣言は書き出さない
+/// @param 書き出し先のバッファ
+/// @return 成功時: True, 失敗時: false
+bool CodeGen::writeBitcode(llvm::SmallVectorImpl<char> &buffer) {
+    if (!Mod) {
+        return false;
+    }
+    for (llvm::Module::iterator it = Mod->begin(); it != Mod->end(); ) {
+        llvm::Function &func = *it++;
+        if (func.isDeclaration() && func.use_empty()) {
+            func.eraseFromParent();
+        }
+    }
+    llvm::raw_svector_ostream stream(buffer);
+    llvm::WriteBitcodeToFile(*Mod, stream);
+    return true;
+}
+
+/// 関数内の名前の通し番号のリセット
+/// 関数内で名前が衝突すると、関数のValueSymbolTableが持つ通し番号を付けて一意にするので、
+/// 最適化で付く名前(reass.add47など)はそれまでの衝突の回数で変わる
+/// Linkerで結合した関数は新しいFunctionに移されて通し番号が0から始まるため、
+/// 逐次生成でも同じく本体を新しいFunctionに移し、並列数によらず同じ出力にする
+/// @param Module
+void CodeGen::resetValueNames(llvm::Module *mod) {
+    std::vector<llvm::Function*> funcs;
+    for (llvm::Function &func : *mod) {
+        if (!func.isDeclaration()) {
+            funcs.push_back(&func);
+        }
+    }
+    for (size_t i = 0; i < funcs.size(); i++) {
+        llvm::Function *func = funcs[i];
+        llvm::Function *moved = llvm::Function::Create(
+            func->getFunctionType(), func->getLinkage(), func->getAddressSpace());
+        mod->getFunctionList().insert(func->getIterator(), moved);
+        moved->copyAttributesFrom(func);
+        // IRLinkerと同じく引数、基本ブロックの順に移す (名前は新しいFunctionに登録し直される)
+        moved->stealArgumentListFrom(*func);
+        moved->getBasicBlockList().splice(moved->end(), func->getBasicBlockList());
+        func->replaceAllUsesWith(moved);
+        moved->takeName(func);
+        func->eraseFromParent();
+    }
+    // 番号からの表は移す前のFunctionを指しているので、次のdoCodeGenまで使わない
+    Functions.clear();
+}
+
+/// 並列Module作成メソッド
+/// 関数定義をjobs個に分割し、スレッドプールで各ワーカが自身のLLVMContextにModuleを生成、最適化する
+/// ワーカのModuleはBitcodeを経由して本体のコンテキストに読み込み、Linkerで結合する
+/// 宣言を先に並べておくので、出力は逐次生成と同じになる
+/// ワーカが行う最適化はmem2regだけで、-O1以上のパイプラインは結合後に1スレッドで行う
+/// (InlinerなどModule全体を見るパスを含み、分割したModuleごとには同じ結果にならないため)
+/// @param TranslationUnitAST Module名(入力ファイル名) 並列数
+/// @return 成功時: True, 失敗時: false
+bool CodeGen::generateParallel(TranslationUnitAST &tunit, std::string name, unsigned jobs) {
+    // 宣言のエラーはワーカを起動する前にここで検出する
+    Mod = new llvm::Module(name, context);
+    if (!generateDeclarations(tunit, Mod)) {
+        SAFE_DELETE(Mod);
+        return false;
+    }
+
+    int func_num = tunit.getFunctionNum();
+    unsigned part_num = std::min<unsigned>(jobs, func_num);
+    std::vector<llvm::SmallVector<char, 0> > buffers(part_num);
+    std::vector<char> results(part_num, false);
+    // time-traceプロファイラはスレッドごとに有効にする
+    bool trace = llvm::timeTraceProfilerEnabled();
+    TimeReport *timing = Timing;
+    bool direct_ssa = DirectSSA;
+    // 診断メッセージは呼び出し元のスレッドと同じ出力先に出す
+    FILE *diag = diagStream();
+    {
+        llvm::ThreadPool pool(llvm::hardware_concurrency(jobs));
+        for (unsigned i = 0; i < part_num; i++) {
+            int begin = (int)((uint64_t)func_num * i / part_num);
+            int end = (int)((uint64_t)func_num * (i + 1) / part_num);
+            pool.async([&tunit, &name, &buffers, &results, i, begin, end, trace, timing, direct_ssa, diag]() {
+                diagStream() = diag;
+                if (trace) {
+                    llvm::timeTraceProfilerInitialize(TraceGranularity, "dcc");
+                }
+                {
+                    CodeGen worker;
+                    worker.setTimeReport(timing);
+                    worker.setDirectSSA(direct_ssa);
+                    TimeScope scope(NULL, "CodeGenPart", name);
+                    results[i] = worker.generateFunctionRange(tunit, name, begin, end) &&
+                                 worker.writeBitcode(buffers[i]);
+                }
+                if (trace) {
+                    llvm::timeTraceProfilerFinishThread();
+                }
+            });
+        }
+        pool.wait();
+    }
+
+    // Linkerは宣言を定義で置き換える際に関数をModuleの末尾へ移すので、
+    // 宣言の並びを覚えておき、Link後に並べ直す
+    std::vector<std::string> func_order;
+    for (llvm::Function &func : *Mod) {
+        func_order.push_back(func.getName().str());
+    }
+
+    // 分割した順にLinkする
+    llvm::Linker linker(*Mod);
+    for (unsigned i = 0; i < part_num; i++) {
+        if (!results[i]) {
             SAFE_DELETE(Mod);
             return false;
         }
+        llvm::MemoryBufferRef ref(llvm::StringRef(buffers[i].data(), buffers[i].size()), name);
+        llvm::Expected<std::unique_ptr<llvm::Module> > part = llvm::parseBitcodeFile(ref, context);
+        if (!part) {
+            fprintf(diagStream(), "error: failed to read module part %u\n", i);
+            llvm::consumeError(part.takeError());
+            SAFE_DELETE(Mod);
+            return false;
+        }
+        if (linker.linkInModule(std::move(*part))) {
+            fprintf(diagStream(), "error: failed to link module part %u\n", i);
+            SAFE_DELETE(Mod);
+            return false;
+        }
+        llvm::SmallVector<char, 0>().swap(buffers[i]);
+    }
+
+    llvm::Module::FunctionListType &func_list = Mod->getFunctionList();
+    for (size_t i = 0; i < func_order.size(); i++) {
+        llvm::Function *func = Mod->getFunction(func_order[i]);
+        func_list.splice(func_list.end(), func_list, func->getIterator());
     }
     return true;
 }
@@ -78,13 +332,13 @@ bool CodeGen::generateTranslationUnit(TranslationUnitAST &tunit, std::string nam
 /// @return 生成したFunctionのポインタ
 llvm::Function *CodeGen::generatePrototype(PrototypeAST *proto, llvm::Module *mod) {
     // already declared??
-    // getFunction(): 与えた名前のFunctionがModulu内に存在するならばFunctionを返す
-    llvm::Function *func = mod->getFunction(proto->getName());
+    // 同じ名前のプロトタイプ宣言と関数定義には同じ番号が割り当てられている
+    llvm::Function *func = Functions[proto->getIndex()];
     if (func) {
         if (func->arg_size() == proto->getParamNum() && func->empty()) {
             return func;
         } else {
-            fprintf(stderr, "error: function %s is redefined", proto->getName().c_str());
+            fprintf(diagStream(), "error: function %s is redefined", proto->getName().str().c_str());
             return NULL;
         }
     }
@@ -117,12 +371,13 @@ llvm::Function *CodeGen::generatePrototype(PrototypeAST *proto, llvm::Module *mo
     func = llvm::Function::Create(func_type,
         llvm::Function::ExternalLinkage,
         proto->getName(), mod);
+    Functions[proto->getIndex()] = func;
     
     // set names
     // Functionの引数イテレータをたどって引数名をPrototypeAST.getParamName() + "_arg"にする
     llvm::Function::arg_iterator arg_iter = func->arg_begin();
     for (int i = 0; i < proto->getParamNum(); i++) {
-        arg_iter->setName(proto->getParamName(i).append("_arg"));
+        arg_iter->setName(proto->getParamName(i) + "_arg");
         arg_iter++;
     }
 
@@ -134,6 +389,8 @@ llvm::Function *CodeGen::generatePrototype(PrototypeAST *proto, llvm::Module *mo
 /// @param FunctionAST Module
 /// @return 生成したFunctionへのポインタ
 llvm::Function *CodeGen::generateFunctionDefinition(FunctionAST * func_ast, llvm::Module *mod) {
+    TimeScope scope(TimeReport::createCodeGenTimer(Timing, func_ast->getName()), "CodeGenFunction", func_ast->getName());
+
     llvm::Function *func = generatePrototype(func_ast->getPrototype(), mod);
     if (!func) {
         return NULL;
@@ -167,6 +424,12 @@ llvm::Value *CodeGen::generateFunctionStatement(FunctionStmtAST *func_stmt) {
     // insert variable decls
     VariableDeclAST *vdecl;
     llvm::Value *v = NULL;
+    if (DirectSSA) {
+        BlockDefs.clear();
+        BlockDefs[Builder->GetInsertBlock()].assign(func_stmt->getVariableDeclNum(), NULL);
+    } else {
+        Slots.assign(func_stmt->getVariableDeclNum(), NULL);
+    }
 
     // generateVariableDeclaration, generateStatementを用いてIRを作成する
     for (int i = 0; ; i++) {
@@ -195,9 +458,19 @@ llvm::Value *CodeGen::generateFunctionStatement(FunctionStmtAST *func_stmt) {
 }
 
 /// 変数宣言(alloca命令)生成メソッド
+/// 直接SSA構築では命令を生成せず、引数の値を変数の最初の値として記録する
 /// @param VariableDeclAST
 /// @return 生成したValueへのポインタ
 llvm::Value *CodeGen::generateVariableDeclaration(VariableDeclAST *vdecl) {
+    if (DirectSSA) {
+        if (vdecl->getType() != VariableDeclAST::param) {
+            return NULL;
+        }
+        llvm::Value *arg = CurFunc->getArg(vdecl->getSlot());
+        writeVariable(vdecl->getSlot(), Builder->GetInsertBlock(), arg);
+        return arg;
+    }
+
     // Alloca命令の作成: CreateAllocaを用いる
     // llvm::IRBuilder::CreateAlloca
     // AllocaInst * CreateAlloca(Type *ty, Value *ArraySize=0, const Twine &Name="")
@@ -209,6 +482,7 @@ llvm::Value *CodeGen::generateVariableDeclaration(VariableDeclAST *vdecl) {
         0,
         vdecl->getName()
     );
+    Slots[vdecl->getSlot()] = alloca;
 
     // if args alloca
     // 関数内のほかの変数と同様に関数の引数に対してアクセスする
@@ -221,11 +495,10 @@ llvm::Value *CodeGen::generateVariableDeclaration(VariableDeclAST *vdecl) {
     // - Val: 格納する値
     // - Ptr: 格納先
     //   - Value: InstructionやGlobalValue, Functionの基底クラス
-    //   - 引数を表すValueを取得する: FunctionのgetValueSymbolTable, ValueSymbolTableのloopupを利用
+    //   - 引数は宣言順に番号が振られているので、変数の番号がそのまま引数の位置になる
     if (vdecl->getType() == VariableDeclAST::param) {
         // Store Args p.119
-        llvm::ValueSymbolTable* vs_table = CurFunc->getValueSymbolTable();
-        Builder->CreateStore(vs_table->lookup(vdecl->getName().append("_arg")), alloca);
+        Builder->CreateStore(CurFunc->getArg(vdecl->getSlot()), alloca);
     }
     return alloca;
 }
@@ -246,6 +519,42 @@ llvm::Value *CodeGen::generateStatement(BaseAST *stmt) {
     }
 }
 
+/// 式の作成
+/// 二項演算、関数呼び出し、変数参照、定数のいずれかを生成する
+/// 被演算子、実引数、戻り値のどこにでも関数呼び出しを書ける
+/// @param BaseAST
+/// @return 生成したValueのポインタ
+llvm::Value *CodeGen::generateExpression(BaseAST *expr) {
+    if (llvm::isa<BinaryExprAST>(expr)) {
+        return generateBinaryExpression(llvm::dyn_cast<BinaryExprAST>(expr));
+    } else if (llvm::isa<CallExprAST>(expr)) {
+        return generateCallExpression(llvm::dyn_cast<CallExprAST>(expr));
+    } else if (llvm::isa<VariableAST>(expr)) {
+        return generateVariable(llvm::dyn_cast<VariableAST>(expr));
+    } else if (llvm::isa<NumberAST>(expr)) {
+        NumberAST *num = llvm::dyn_cast<NumberAST>(expr);
+        return generateNumber(num->getNumberValue());
+    } else {
+        return NULL;
+    }
+}
+
+/// 値として使う式の作成 (実引数と戻り値)
+/// 代入式の値は代入した変数の値になる
+/// alloca方式の代入はstore命令を返すので、代入した変数を読み直す
+/// 直接SSA構築では代入式の値がそのまま変数の値
+/// @param BaseAST 読み直すload命令の名前
+/// @return 生成したValueのポインタ
+llvm::Value *CodeGen::generateExpressionValue(BaseAST *expr, const llvm::Twine &name) {
+    llvm::Value *v = generateExpression(expr);
+    BinaryExprAST *bin_expr = llvm::dyn_cast<BinaryExprAST>(expr);
+    if (bin_expr && bin_expr->getOp() == "=" && !DirectSSA) {
+        VariableAST *var = llvm::dyn_cast<VariableAST>(bin_expr->getLHS());
+        v = Builder->CreateLoad(llvm::Type::getInt32Ty(context), Slots[var->getSlot()], name);
+    }
+    return v;
+}
+
 /// 二項演算生成メソッド
 /// @param JumpStmtAST
 /// @return 生成したValueへのポインタ
@@ -261,41 +570,22 @@ llvm::Value *CodeGen::generateBinaryExpression(BinaryExprAST *bin_expr) {
     if (bin_expr->getOp() == "=") {
         // lhs is variable
         VariableAST *lhs_var = llvm::dyn_cast<VariableAST>(lhs);
-        llvm::ValueSymbolTable* vs_table = CurFunc->getValueSymbolTable();
-        lhs_v = vs_table->lookup(lhs_var->getName());
+
+        // 直接SSA構築では右辺の値を変数の現在の値にするだけで、命令は生成しない
+        if (DirectSSA) {
+            rhs_v = generateExpression(rhs);
+            writeVariable(lhs_var->getSlot(), Builder->GetInsertBlock(), rhs_v);
+            return rhs_v;
+        }
+        lhs_v = Slots[lhs_var->getSlot()];
 
     // other operand
     } else {
-        // lhs = ?
-
-        // Binary?
-        if (llvm::isa<BinaryExprAST>(lhs)) {
-            lhs_v = generateBinaryExpression(llvm::dyn_cast<BinaryExprAST>(lhs));
-        
-        // Variable?
-        } else if (llvm::isa<VariableAST>(lhs)) {
-            lhs_v = generateVariable(llvm::dyn_cast<VariableAST>(lhs));
-        
-        // Number?
-        } else if (llvm::isa<NumberAST>(lhs)) {
-            NumberAST *num = llvm::dyn_cast<NumberAST>(lhs);
-            lhs_v = generateNumber(num->getNumberValue());
-        }
+        lhs_v = generateExpression(lhs);
     }
 
     // create rhs value
-    if (llvm::isa<BinaryExprAST>(rhs)) {
-        rhs_v = generateBinaryExpression(llvm::dyn_cast<BinaryExprAST>(rhs));
-
-    // Variable?
-    } else if (llvm::isa<VariableAST>(rhs)) {
-        rhs_v = generateVariable(llvm::dyn_cast<VariableAST>(rhs));
-    
-    // Number?
-    } else if (llvm::isa<NumberAST>(rhs)) {
-        NumberAST *num = llvm::dyn_cast<NumberAST>(rhs);
-        rhs_v = generateNumber(num->getNumberValue());
-    }
+    rhs_v = generateExpression(rhs);
 
     // 四則演算命令の生成
     if (bin_expr->getOp() == "=") {
@@ -303,16 +593,16 @@ llvm::Value *CodeGen::generateBinaryExpression(BinaryExprAST *bin_expr) {
         return Builder->CreateStore(rhs_v, lhs_v);
     } else if (bin_expr->getOp() == "+") {
         // add
-        return Builder->CreateAdd(rhs_v, lhs_v, "add_tmp");
+        return Builder->CreateAdd(lhs_v, rhs_v, "add_tmp");
     } else if (bin_expr->getOp() == "-") {
         // sub
-        return Builder->CreateSub(rhs_v, lhs_v, "sub_tmp");
+        return Builder->CreateSub(lhs_v, rhs_v, "sub_tmp");
     } else if (bin_expr->getOp() == "*") {
         // mul
-        return Builder->CreateMul(rhs_v, lhs_v, "mul_tmp");
+        return Builder->CreateMul(lhs_v, rhs_v, "mul_tmp");
     } else if (bin_expr->getOp() == "/") {
         // div
-        return Builder->CreateSDiv(rhs_v, lhs_v, "div_tmp");
+        return Builder->CreateSDiv(lhs_v, rhs_v, "div_tmp");
     }
     // unreachable
     return NULL;
@@ -325,42 +615,21 @@ llvm::Value *CodeGen::generateCallExpression(CallExprAST *call_expr) {
     std::vector<llvm::Value*> arg_vec;
     BaseAST *arg;
     llvm::Value *arg_v;
-    llvm::ValueSymbolTable* vs_table = CurFunc->getValueSymbolTable();
     for (int i = 0; ; i++) {
         if (!(arg = call_expr->getArgs(i)))
             break;
-        
-        // is call
-        if (llvm::isa<CallExprAST>(arg)) {
-            arg_v = generateCallExpression(llvm::dyn_cast<CallExprAST>(arg));
-
-        // isBinaryExpr
-        } else if (llvm::isa<BinaryExprAST>(arg)) {
-            BinaryExprAST *bin_expr = llvm::dyn_cast<BinaryExprAST>(arg);
-            arg_v = generateBinaryExpression(llvm::dyn_cast<BinaryExprAST>(arg));
-            if (bin_expr->getOp() == "=") {
-                VariableAST *var = llvm::dyn_cast<VariableAST>(bin_expr->getLHS());
-                arg_v = Builder->CreateLoad(vs_table->lookup(var->getName()), "arg_val");
-            }
-
-        // isVar
-        } else if (llvm::isa<VariableAST>(arg)) {
-            arg_v = generateVariable(llvm::dyn_cast<VariableAST>(arg));
-
-        // isNumber
-        } else if (llvm::isa<NumberAST>(arg)) {
-            NumberAST *num = llvm::dyn_cast<NumberAST>(arg);
-            arg_v = generateNumber(num->getNumberValue());
-        }
+
+        // 代入式は代入した変数の値を渡す
+        arg_v = generateExpressionValue(arg, "arg_val");
         arg_vec.push_back(arg_v);
     }
 
     // LLVM::IRBuilder::CreateCall
     // CallInst * CreateCall(Value *Callee, ArrayRef<Value *> Args, const Twine &Name="")
-    // - callee: 呼び出し対象Function, ModuleクラスにgetFunctionを関数名指定して取得する
+    // - callee: 呼び出し対象Function, 構文解析で割り当てた関数の番号で引く
     // - Args: 引数として渡すValue, std::vecrotに詰め込んで渡す
     // - name: 関数呼び出しの戻り値を角野数るレジスタ名
-    return Builder->CreateCall(Mod->getFunction(call_expr->getCallee()), arg_vec, "call_tmp");
+    return Builder->CreateCall(Functions[call_expr->getCalleeIndex()], arg_vec, "call_tmp");
 }
 
 /// return文の生成
@@ -369,17 +638,8 @@ llvm::Value *CodeGen::generateCallExpression(CallExprAST *call_expr) {
 /// @return 生成したValueのポインタ
 llvm::Value *CodeGen::generateJumpStatement(JumpStmtAST *jump_stmt) {
     BaseAST *expr = jump_stmt->getExpr();
-    llvm::Value *ret_v;
-
-    if (llvm::isa<BinaryExprAST>(expr)) {
-        ret_v = generateBinaryExpression(llvm::dyn_cast<BinaryExprAST>(expr));
-    } else if (llvm::isa<VariableAST>(expr)) {
-        VariableAST *var = llvm::dyn_cast<VariableAST>(expr);
-        ret_v = generateVariable(var);
-    } else if (llvm::isa<NumberAST>(expr)) {
-        NumberAST *num = llvm::dyn_cast<NumberAST>(expr);
-        ret_v = generateNumber(num->getNumberValue());
-    }
+    // 代入式は代入した変数の値を返す
+    llvm::Value *ret_v = generateExpressionValue(expr, "ret_val");
     // IRBuilder::CreateRef
     // ReturnInst * CreateRet(Value *V)
     Builder->CreateRet(ret_v);
@@ -391,14 +651,75 @@ llvm::Value *CodeGen::generateJumpStatement(JumpStmtAST *jump_stmt) {
 /// @param VariableAST
 /// @return 生成したValueのポインタ
 llvm::Value *CodeGen::generateVariable(VariableAST *var) {
-    llvm::ValueSymbolTable* vs_table = CurFunc->getValueSymbolTable();
+    if (DirectSSA) {
+        return readVariable(var->getSlot(), Builder->GetInsertBlock());
+    }
+
     // llvm::IRBuilder::CreateLoad
-    // LoadInst * CreateLoad(Value *Ptr, const Twine &Name="")
+    // LoadInst * CreateLoad(Type *Ty, Value *Ptr, const Twine &Name="")
+    // - Ty: Loadする値の型 (LLVM 14以降は明示が必要)
     // - Ptr: Load対象のValue
-    //   - ValueSymbolTableからAllocaInstを取得して指定
-    return Builder->CreateLoad(vs_table->lookup(var->getName()), "var_tmp");
+    //   - 構文解析で割り当てた変数の番号でAllocaInstを引いて指定
+    return Builder->CreateLoad(llvm::Type::getInt32Ty(context), Slots[var->getSlot()], "var_tmp");
 }
 
+// S: 直接SSA構築
+// Braunらの方法 (Simple and Efficient Construction of Static Single Assignment Form) に従い、
+// BasicBlockごとに各変数の現在の値を記録する
+// 現在の言語は関数本体が1つのBasicBlockなので、読み出しはentryブロックの表を引くだけで済む
+// 制御構文を追加した場合は、合流するBasicBlockの読み出しでphiが作られる
+
+/// 変数の値の記録
+/// @param 変数の番号 BasicBlock 値
+void CodeGen::writeVariable(int slot, llvm::BasicBlock *block, llvm::Value *value) {
+    std::vector<llvm::Value*> &defs = BlockDefs[block];
+    if (defs.size() <= (size_t)slot) {
+        defs.resize(slot + 1, NULL);
+    }
+    defs[slot] = value;
+}
+
+/// 変数の値の読み出し
+/// @param 変数の番号 BasicBlock
+/// @return BasicBlockの末尾での変数の値
+llvm::Value *CodeGen::readVariable(int slot, llvm::BasicBlock *block) {
+    llvm::DenseMap<llvm::BasicBlock*, std::vector<llvm::Value*> >::iterator it = BlockDefs.find(block);
+    if (it != BlockDefs.end() && (size_t)slot < it->second.size() && it->second[slot]) {
+        return it->second[slot];
+    }
+    return readVariableRecursive(slot, block);
+}
+
+/// BasicBlock内で記録されていない変数の値を先行ブロックから求める
+/// - 先行ブロックがない(entry): 一度も代入されていない変数なのでundef (mem2regと同じ)
+/// - 先行ブロックが1つ: その末尾での値
+/// - 先行ブロックが複数: phiを置き、各先行ブロックの末尾での値を受け取る
+///   phiは値を引く前に記録するので、読み出しが循環しても止まる
+///   先行ブロックがすべて生成済み(ループの戻り辺がない)ことを前提とする
+///   ループを追加する場合は、戻り辺が揃うまでphiの引数を保留する必要がある
+/// @param 変数の番号 BasicBlock
+/// @return BasicBlockでの変数の値
+llvm::Value *CodeGen::readVariableRecursive(int slot, llvm::BasicBlock *block) {
+    llvm::Value *value;
+    if (llvm::BasicBlock *pred = block->getSinglePredecessor()) {
+        value = readVariable(slot, pred);
+    } else if (llvm::pred_empty(block)) {
+        value = llvm::UndefValue::get(llvm::Type::getInt32Ty(context));
+    } else {
+        llvm::IRBuilder<> phi_builder(block, block->begin());
+        llvm::PHINode *phi = phi_builder.CreatePHI(llvm::Type::getInt32Ty(context), 2, "phi_tmp");
+        writeVariable(slot, block, phi);
+        for (llvm::BasicBlock *pred : llvm::predecessors(block)) {
+            phi->addIncoming(readVariable(slot, pred), pred);
+        }
+        value = phi;
+    }
+    writeVariable(slot, block, value);
+    return value;
+}
+
+// E: 直接SSA構築
+
 /// 定数生成メソッド
 /// 引数に与えられた値を示すValueを生成する
 /// @param 生成する定数の値
@@ -412,21 +733,3 @@ llvm::Value *CodeGen::generateNumber(int value) {
         value
     );
 }
-
-
-// bool CodeGen::linkModule(llvm::Module *dest, std::string file_name){
-//     llvm::SMDiagnostic err;
-//     llvm::Module *link_mod = llvm::parseIRFile(file_name, err, context);
-//     if(!link_mod)
-//         return false;
-
-//     std::string err_msg;
-//     // if(llvm::Linker::LinkModules(dest, link_mod, llvm::None, &err_msg))
-//     if(llvm::Linker::linkModules(dest, link_mod, llvm::None))
-//         return false;
-
-//     // SAFE_DELETE(link_mod);
-//     SAFE_DELETEU(link_mod);
-
-//     return true;
-// }
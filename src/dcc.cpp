@@ -13,73 +13,31 @@
 #include "llvm/Support/FileSystem.h"  //added
 #include "llvm/Support/raw_ostream.h"  //added
 
+#include<cstring>
+
 #include "ast.hpp"
+#include "batch.hpp"
+#include "cache.hpp"
 #include "codegen.hpp"
+#include "driver.hpp"
+#include "emitter.hpp"
 #include "lexer.hpp"
+#include "memstats.hpp"
+#include "option.hpp"
 #include "parser.hpp"
+#include "server.hpp"
+#include "timing.hpp"
 
-/// 引数のオプション切り出しクラス
-class OptionParser {
-    private:
-        std::string InputFilename;
-        std::string OutputFilename;
-        int Argc;
-        char **Argv;
-
-    public:
-        OptionParser(int argc, char **argv):Argc(argc), Argv(argv) {}
-        void printHelp() {
-            // ヘルプ表示
-            fprintf(stdout, "Compiler for DummyC...\n");
-        }
-        std::string getInputFileName() { return InputFilename; } // 入力ファイル名の取得
-        std::string getOutputFileName() { return OutputFilename; } // 出力ファイル名の取得
-        bool parseOption(); // オプション切り出しメソッド
-};
-
-/// オプション切り出しメソッド
-/// @return 成功時: True, 失敗時: false
-bool OptionParser::parseOption() {
-    if (Argc < 2) {
-        fprintf(stderr, "引数がたりません\n");
-        return false;
-    }
-
-    for (int i = 1; i < Argc; i++) {
-        if (Argv[i][0] == '-' && Argv[i][1] == 'o' && Argv[i][2] == '\0') {
-            // output file name
-            OutputFilename.assign(Argv[++i]);
-        } else if (Argv[i][0] == '-' && Argv[i][1] == 'h' && Argv[i][2] == '\0') {
-            printHelp();
-            return false;
-        } else if (Argv[i][0] == '-') {
-            fprintf(stderr, "%s は不明なオプションです\n", Argv[i]);
-            return false;
-        } else {
-            // inputFilename
-            InputFilename.assign(Argv[i]);
-        }
-    }
-
-    // Output filename
-    std::string ifn = InputFilename;
-    int len = ifn.length();
-    if (OutputFilename.empty() && (len > 2) &&
-        ifn[len - 3] == '.' && ((ifn[len - 2] == 'd' && ifn[len - 1] == 'c'))) {
-        OutputFilename = std::string(ifn.begin(), ifn.end() - 3);
-        OutputFilename += ".ll";
-    } else if (OutputFilename.empty()) {
-        OutputFilename = ifn;
-        OutputFilename += ".ll";
-    }
-    return true;
-}
+// lib/printnum.c dccの実行ファイルの位置を調べるのにも使う
+extern "C" int printnum(int i);
 
 /// main関数
 /// OptionParserの呼び出し
 /// 各種クラスの生成とメソッド呼び出し、コンパイルとファイル呼び出し
 int main(int argc, char **argv) {
     llvm::InitializeNativeTarget(); // ホスト環境に合わせてネイティブターゲットを初期化
+    llvm::InitializeNativeTargetAsmPrinter(); // JIT実行とオブジェクト出力に使う
+    llvm::InitializeNativeTargetAsmParser();
     // llvm::sys::PrintStackTraceOnErrorSignal(); // スタックトレースの出力
     llvm::sys::PrintStackTraceOnErrorSignal(*argv);
     llvm::PrettyStackTraceProgram X(argc, argv); // クラッシュした際に指定された引数をストリームに出力
@@ -89,77 +47,87 @@ int main(int argc, char **argv) {
     if (!opt.parseOption())
         exit(1);
 
+    // --no-runtimeの実行ファイルにはdccと同じディレクトリに置かれたランタイムをリンクする
+    llvm::SmallString<128> runtime_path(llvm::sys::path::parent_path(
+        llvm::sys::fs::getMainExecutable(argv[0], (void*)&printnum)));
+    llvm::sys::path::append(runtime_path, "libprintnum.a");
+
+    // コンパイルサーバ
+    if (!opt.getServeSocket().empty()) {
+        CompileServer server(opt.getServeSocket(), opt.getJobs(), runtime_path.str().str());
+        return server.run();
+    }
+
+    // 入力ファイルなしの--cache-statsは統計の表示だけを行う
+    if (opt.getCacheStats() && opt.getInputFileNames().empty()) {
+        CompileCache cache(opt.getCacheDir(), opt.getCacheMaxSize());
+        return cache.printStats(stdout) ? 0 : 1;
+    }
+
     // check
     if (opt.getInputFileName().length() == 0) {
         fprintf(stderr, "入力ファイルが指定されていません\n");
         exit(1);
     }
 
-    // lex and parse
-    // パーサクラスのインスタンスを生成
-    Parser *parser = new Parser(opt.getInputFileName());
-    
-    // 構文解析、意味解析を行う
-    if (!parser->doParse()) {
-        fprintf(stderr, "err at parser or lexer\n");
-        SAFE_DELETE(parser);
-        exit(1);
+    // 時間の計測 無効なら計測区間は何もしない
+    // LLVMのパスの時間はTimePassesIsEnabledで有効にする (Driverを作る前に設定する)
+    TimeReport *timing = NULL;
+    if (opt.getTimeReport()) {
+        llvm::TimePassesIsEnabled = true;
+        timing = new TimeReport();
     }
-
-    // get AST
-    TranslationUnitAST &tunit = parser->getAST();
-    if (tunit.empty()) {
-        fprintf(stderr, "TranslationUnit is empty");
-        SAFE_DELETE(parser);
-        exit(1);
+    if (!opt.getTracePath().empty()) {
+        llvm::timeTraceProfilerInitialize(TraceGranularity, "dcc");
     }
 
-    // コード生成
-    CodeGen *codegen = new CodeGen();
-    if (!codegen->doCodeGen(tunit, opt.getInputFileName())) {
-        fprintf(stderr, "err at codegen\n");
-        SAFE_DELETE(parser);
-        exit(1);
+    // 複数の入力ファイルは-jの数のワーカで並列にコンパイルする
+    int result;
+    if (opt.getInputFileNames().size() > 1) {
+        BatchCompiler batch(opt, opt.getJobs(), runtime_path.str().str());
+        result = batch.run();
+    } else {
+        // 構文解析から出力まで
+        Driver driver(runtime_path.str().str());
+        driver.setTimeReport(timing);
+        MemoryStats *memory = NULL;
+        if (opt.getMemStats()) {
+            memory = new MemoryStats(opt.getInputFileName());
+            memory->samplePhase("startup");
+            driver.setMemoryStats(memory);
+        }
+        {
+            TimeScope scope(NULL, "Compile", opt.getInputFileName());
+            result = driver.compileFile(opt);
+        }
+        if (memory) {
+            if (opt.getMemStatsPath().empty()) {
+                memory->printText(stderr);
+            } else if (!memory->writeJSON(opt.getMemStatsPath())) {
+                result = result ? result : 1;
+            }
+            SAFE_DELETE(memory);
+        }
+        if (timing) {
+            timing->print(llvm::errs());
+            driver.printPassTimes();
+            llvm::reportAndResetTimings(&llvm::errs());
+        }
     }
+    SAFE_DELETE(timing);
 
-    // get Module
-    llvm::Module &mod = codegen->getModule();
-    if (mod.empty()) {
-        fprintf(stderr, "Module is empty\n");
-        SAFE_DELETE(parser);
-        exit(1);
+    // Chrome/Perfettoで読み込めるJSONを書き出す
+    if (!opt.getTracePath().empty()) {
+        if (llvm::Error err = llvm::timeTraceProfilerWrite(opt.getTracePath(), opt.getInputFileName())) {
+            fprintf(stderr, "failed to write trace: %s\n", llvm::toString(std::move(err)).c_str());
+            result = result ? result : 1;
+        }
+        llvm::timeTraceProfilerCleanup();
     }
 
-    // ファイル出力
-    llvm::legacy::PassManager pm;
-    // std::string error;
-    std::error_code ec;
-
-    // mem2regをPassMangerに登録
-    pm.add(llvm::createPromoteMemoryToRegisterPass());
-
-    // raw_fd_ostream
-    // raw_fd_ostream(const char *Filename, std::string &ErrorInfo, unsigned Flags=0)
-    //  - filename: 出力先ファイル名
-    //  - errorinfo: エラー情報を格納するstring
-    //  - flags: ファイルを開くオプション
-    // llvm::raw_fd_ostream raw_stream(opt.getOutputFileName().c_str(), error);
-    llvm::raw_fd_ostream raw_stream(opt.getOutputFileName().c_str(), ec);
-
-    // PrimtModulePassはPassManagerのaddメソッドで登録、runで適用
-    // llvm::CreatePrintModulePass
-    // ModulePass* llvm::createPrintModulePass(raw_ostrean * OS, bool DeleteStream = false, const std::string &Banner="")
-    // - OS: 出力ストリームの指定
-    // - DeleteStream: パスを実行後に第一引数で渡したストリームをDeleteするかしないか
-    // - Banner: ストリームの先頭にBannerに指定した文字列が出力される
-    // pm.add(llvm::createPrintModulePass(&raw_stream));
-    pm.add(llvm::createPrintModulePass(raw_stream));
-    pm.run(mod);
-    raw_stream.close();
-
-    // 終了処理
-    SAFE_DELETE(parser);
-    SAFE_DELETE(codegen);
-
-    return 0;
+    if (opt.getCacheStats()) {
+        CompileCache cache(opt.getCacheDir(), opt.getCacheMaxSize());
+        cache.printStats(stderr);
+    }
+    return result;
 }
@@ -0,0 +1,366 @@
+// Driverクラスのメソッドを実装していく
+
+#include "driver.hpp"
+
+// lib/printnum.c JIT実行時に呼び出し先として登録する
+extern "C" int printnum(int i);
+
+// CodeGenを作り直すまでに処理するソースの数
+// LLVMContextには定数などが蓄積していくので、使い回すのは一定数までにする
+static const unsigned MaxCompilesPerContext = 1024;
+
+/// コンストラクタ
+/// @param 実行ファイルにリンクするランタイムのパス
+Driver::Driver(std::string runtime_path) : CompileCount(0), Timing(NULL), Memory(NULL) {
+    Backend = new Emitter(runtime_path);
+    Generator = new CodeGen();
+}
+
+/// デストラクタ
+Driver::~Driver() {
+    SAFE_DELETE(Generator);
+    SAFE_DELETE(Backend);
+}
+
+/// 入力ファイルのコンパイル
+/// 出力はOptionParserの出力ファイル名に書き出す (--runならJIT実行する)
+/// @param オプション
+/// @return 終了ステータス (--runならmain関数の戻り値)
+int Driver::compileFile(OptionParser &opt) {
+    return compileFile(opt, opt.getInputFileName(), opt.getJobs());
+}
+
+/// 指定した入力ファイルのコンパイル
+/// 複数ファイルを並列にコンパイルする場合に、ファイルごとに呼び出す
+/// @param オプション 入力ファイル名 コード生成の並列数
+/// @return 終了ステータス (--runならmain関数の戻り値)
+int Driver::compileFile(OptionParser &opt, std::string input_filename, unsigned jobs) {
+    // lex and parse
+    // パーサクラスのインスタンスを生成
+    if (opt.getCacheDir().empty() || opt.getRun()) {
+        Parser *parser = createParser(opt, input_filename);
+        int result = compile(opt, parser, input_filename, jobs, NULL);
+        SAFE_DELETE(parser);
+        return result;
+    }
+
+    // キャッシュを使う場合はソースを読んでキーを作り、ヒットすれば保存されたModuleから出力する
+    llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer> > source = llvm::MemoryBuffer::getFile(input_filename);
+    if (!source) {
+        fprintf(diagStream(), "failed to read %s: %s\n", input_filename.c_str(), source.getError().message().c_str());
+        return 1;
+    }
+    CompileCache cache(opt.getCacheDir(), opt.getCacheMaxSize());
+    std::string key = cache.computeKey(opt, (*source)->getBuffer());
+    std::unique_ptr<llvm::MemoryBuffer> cached = cache.lookup(key);
+    if (cached) {
+        int result = emitCached(opt, input_filename, *cached, NULL);
+        if (result >= 0) {
+            return result;
+        }
+    }
+
+    Parser *parser = createParser(opt, std::move(*source));
+    llvm::SmallVector<char, 0> entry;
+    int result = compile(opt, parser, input_filename, jobs, NULL, &entry);
+    SAFE_DELETE(parser);
+    if (result == 0) {
+        cache.store(key, llvm::StringRef(entry.data(), entry.size()));
+    }
+    return result;
+}
+
+/// メモリ上のソースのコンパイル
+/// 出力はファイルに書き出さずバッファに格納する (--runは使えない)
+/// @param オプション ソースバッファ 出力先バッファ
+/// @return 終了ステータス
+int Driver::compileBuffer(OptionParser &opt, std::unique_ptr<llvm::MemoryBuffer> source,
+                          llvm::SmallVectorImpl<char> &output) {
+    if (opt.getRun()) {
+        fprintf(diagStream(), "--run cannot be used here\n");
+        return 1;
+    }
+    if (opt.getCacheDir().empty()) {
+        Parser *parser = createParser(opt, std::move(source));
+        int result = compile(opt, parser, opt.getInputFileName(), opt.getJobs(), &output);
+        SAFE_DELETE(parser);
+        return result;
+    }
+
+    CompileCache cache(opt.getCacheDir(), opt.getCacheMaxSize());
+    std::string key = cache.computeKey(opt, source->getBuffer());
+    std::unique_ptr<llvm::MemoryBuffer> cached = cache.lookup(key);
+    if (cached) {
+        int result = emitCached(opt, opt.getInputFileName(), *cached, &output);
+        if (result >= 0) {
+            return result;
+        }
+        output.clear();
+    }
+
+    Parser *parser = createParser(opt, std::move(source));
+    llvm::SmallVector<char, 0> entry;
+    int result = compile(opt, parser, opt.getInputFileName(), opt.getJobs(), &output, &entry);
+    SAFE_DELETE(parser);
+    if (result == 0) {
+        cache.store(key, llvm::StringRef(entry.data(), entry.size()));
+    }
+    return result;
+}
+
+/// キャッシュから取り出したModuleの出力
+/// エントリは最適化後のModuleのBitcodeなので、読み込んでModule名とsource_filenameを
+/// 入力ファイル名にしてから、キャッシュを使わない場合と同じく指定した形式で出力する
+/// @param オプション 入力ファイル名 キャッシュのエントリ 出力先バッファ(NULLならファイルに出力)
+/// @return 終了ステータス 読み込めないエントリなら-1 (呼び出し側でコンパイルし直す)
+int Driver::emitCached(OptionParser &opt, std::string input_filename, llvm::MemoryBuffer &entry,
+                       llvm::SmallVectorImpl<char> *output) {
+    recycleGenerator();
+    llvm::Expected<std::unique_ptr<llvm::Module> > mod =
+        llvm::parseBitcodeFile(entry.getMemBufferRef(), Generator->context);
+    if (!mod) {
+        fprintf(diagStream(), "ignoring broken cache entry: %s\n", llvm::toString(mod.takeError()).c_str());
+        return -1;
+    }
+    (*mod)->setModuleIdentifier(input_filename);
+    (*mod)->setSourceFileName(input_filename);
+    return emitModule(opt, **mod, input_filename, output) ? 0 : 1;
+}
+
+/// CodeGenの作り直し
+/// LLVMContextには定数などが蓄積していくので、使い回すのはMaxCompilesPerContext個のソースまでにする
+void Driver::recycleGenerator() {
+    if (++CompileCount > MaxCompilesPerContext) {
+        SAFE_DELETE(Generator);
+        Generator = new CodeGen();
+        CompileCount = 1;
+    }
+}
+
+/// パーサの生成
+/// 一括字句解析ではここで字句解析を行うので、字句解析の時間として計測する
+/// @param オプション 入力ファイル名
+/// @return Parser
+Parser *Driver::createParser(OptionParser &opt, std::string input_filename) {
+    TimeScope scope(TimeReport::getPhaseTimer(Timing, TimeReport::PHASE_LEX), "Lex", input_filename);
+    Parser *parser = new Parser(input_filename, opt.getTokenWindow());
+    parser->setTimeReport(Timing);
+    if (Memory) {
+        Memory->samplePhase("lex");
+    }
+    return parser;
+}
+
+/// パーサの生成
+/// @param オプション ソースバッファ
+/// @return Parser
+Parser *Driver::createParser(OptionParser &opt, std::unique_ptr<llvm::MemoryBuffer> source) {
+    TimeScope scope(TimeReport::getPhaseTimer(Timing, TimeReport::PHASE_LEX), "Lex", source->getBufferIdentifier());
+    Parser *parser = new Parser(std::move(source), opt.getTokenWindow());
+    parser->setTimeReport(Timing);
+    if (Memory) {
+        Memory->samplePhase("lex");
+    }
+    return parser;
+}
+
+/// コンパイル処理
+/// 構文解析、ASTの簡約、コード生成、ランタイムのリンク、最適化、出力の順に行う
+/// キャッシュのエントリを渡した場合は、最適化後のModuleをBitcodeで格納する
+/// @param オプション パーサ 入力ファイル名 コード生成の並列数 出力先バッファ(NULLならファイルに出力)
+///        キャッシュのエントリの格納先(NULLなら格納しない)
+/// @return 終了ステータス
+int Driver::compile(OptionParser &opt, Parser *parser, std::string input_filename, unsigned jobs,
+                    llvm::SmallVectorImpl<char> *output, llvm::SmallVectorImpl<char> *cache_entry) {
+    // 構文解析、意味解析を行う
+    bool parsed;
+    {
+        TimeScope scope(TimeReport::getPhaseTimer(Timing, TimeReport::PHASE_PARSE), "Parse", input_filename);
+        parsed = parser->doParse();
+    }
+    if (!parsed) {
+        fprintf(diagStream(), "err at parser or lexer\n");
+        return 1;
+    }
+
+    // get AST
+    TranslationUnitAST &tunit = parser->getAST();
+    if (tunit.empty()) {
+        fprintf(diagStream(), "TranslationUnit is empty");
+        return 1;
+    }
+
+    // Arenaの統計表示
+    if (opt.getArenaStats()) {
+        tunit.getArena().printStats(diagStream(), "ast");
+    }
+    if (Memory) {
+        Memory->samplePhase("parse");
+        parser->reportMemory(*Memory);
+        Memory->recordAST(tunit);
+    }
+
+    // ASTの簡約 定数の畳み込みなどでコード生成する節点を減らす
+    if (!opt.getNoSimplify()) {
+        ASTSimplifier simplifier(tunit);
+        {
+            TimeScope scope(TimeReport::getPhaseTimer(Timing, TimeReport::PHASE_SIMPLIFY), "Simplify", input_filename);
+            simplifier.doSimplify();
+        }
+        if (opt.getSimplifyStats()) {
+            simplifier.printStats(diagStream());
+        }
+    }
+
+    // コード生成
+    recycleGenerator();
+    Generator->setTimeReport(Timing);
+    Generator->setDirectSSA(opt.getDirectSSA());
+    bool generated;
+    {
+        TimeScope scope(TimeReport::getPhaseTimer(Timing, TimeReport::PHASE_CODEGEN), "CodeGen", input_filename);
+        generated = Generator->doCodeGen(tunit, input_filename, jobs);
+    }
+    if (!generated) {
+        fprintf(diagStream(), "err at codegen\n");
+        return 1;
+    }
+
+    // get Module
+    llvm::Module &mod = Generator->getModule();
+    if (mod.empty()) {
+        fprintf(diagStream(), "Module is empty\n");
+        return 1;
+    }
+    if (!verifyModule(mod)) {
+        fprintf(diagStream(), "err at codegen\n");
+        return 1;
+    }
+    if (Memory) {
+        Memory->samplePhase("codegen");
+        Memory->recordModule("codegen", mod);
+    }
+
+    // 埋め込んだランタイムを最適化の前にリンクする
+    if (!opt.getNoRuntime()) {
+        TimeScope scope(TimeReport::getPhaseTimer(Timing, TimeReport::PHASE_RUNTIME), "LinkRuntime");
+        if (!Generator->linkRuntime()) {
+            fprintf(diagStream(), "err at runtime\n");
+            return 1;
+        }
+    }
+    if (Memory) {
+        Memory->samplePhase("runtime");
+    }
+
+    // 最適化
+    {
+        TimeScope scope(TimeReport::getPhaseTimer(Timing, TimeReport::PHASE_OPTIMIZE), "Optimize");
+        if (!Backend->optimizeModule(mod, opt.getOptLevel(), opt.getPasses())) {
+            fprintf(diagStream(), "err at optimizer\n");
+            return 1;
+        }
+    }
+    if (Memory) {
+        Memory->samplePhase("optimize");
+        Memory->recordModule("optimized", mod);
+    }
+
+    // JIT実行
+    if (opt.getRun()) {
+        return runModule();
+    }
+
+    // キャッシュには出力形式と入力ファイル名によらない最適化後のModuleを保存する
+    if (cache_entry) {
+        llvm::raw_svector_ostream stream(*cache_entry);
+        llvm::WriteBitcodeToFile(mod, stream, true);
+    }
+
+    // ファイル出力
+    if (!emitModule(opt, mod, input_filename, output)) {
+        return 1;
+    }
+    if (Memory) {
+        Memory->samplePhase("output");
+    }
+    return 0;
+}
+
+/// 指定した形式での出力
+/// @param オプション Module 入力ファイル名 出力先バッファ(NULLならファイルに出力)
+/// @return 成功時: true, 失敗時: false
+bool Driver::emitModule(OptionParser &opt, llvm::Module &mod, std::string input_filename,
+                        llvm::SmallVectorImpl<char> *output) {
+    bool emitted;
+    {
+        TimeScope scope(TimeReport::getPhaseTimer(Timing, TimeReport::PHASE_OUTPUT), "Output");
+        emitted = output ? Backend->emitBuffer(mod, opt.getOutputKind(), *output)
+                         : Backend->emitFile(mod, opt.getOutputKind(), opt.getOutputFileName(input_filename));
+    }
+    if (!emitted) {
+        fprintf(diagStream(), "err at output\n");
+        return false;
+    }
+    return true;
+}
+
+/// Moduleの検証
+/// 不正なIRは最適化パイプラインやMCJITの中で異常終了させるので、渡す前に検出する
+/// (サーバではリクエスト1つの誤りでプロセスごと落ちることになる)
+/// 検証器の診断出力は型の合わない命令を表示しようとして落ちることがあるので、
+/// 出力はせずに不正な関数の名前だけを報告する
+/// @param Module
+/// @return 正しい: true, 不正: false (不正な関数を標準エラーに出力する)
+bool Driver::verifyModule(llvm::Module &mod) {
+    if (!llvm::verifyModule(mod)) {
+        return true;
+    }
+    fprintf(diagStream(), "error: invalid module %s\n", mod.getModuleIdentifier().c_str());
+    for (llvm::Function &func : mod) {
+        if (!func.isDeclaration() && llvm::verifyFunction(func)) {
+            fprintf(diagStream(), "  in function %s\n", func.getName().str().c_str());
+        }
+    }
+    return false;
+}
+
+/// JIT実行
+/// Moduleを同じプロセス内でMCJITによりコンパイルし、main関数を呼び出す
+/// --no-runtimeでランタイムをリンクしていない場合、
+/// printnumはdccにリンクされたlib/printnum.cの実装に結び付ける
+/// ランタイムをリンクした後のModuleをもう一度検証し、不正なIRはJITに渡さない
+/// Moduleの所有権はExecutionEngineに移る
+/// @return main関数の戻り値 失敗時は-1
+int Driver::runModule() {
+    if (!verifyModule(Generator->getModule())) {
+        fprintf(diagStream(), "err at jit\n");
+        return -1;
+    }
+    llvm::sys::DynamicLibrary::AddSymbol("printnum", (void*)&printnum);
+
+    std::string error;
+    llvm::ExecutionEngine *engine =
+        llvm::EngineBuilder(std::unique_ptr<llvm::Module>(Generator->releaseModule()))
+            .setEngineKind(llvm::EngineKind::JIT)
+            .setErrorStr(&error)
+            .create();
+    if (!engine) {
+        fprintf(diagStream(), "failed to create ExecutionEngine: %s\n", error.c_str());
+        return -1;
+    }
+    engine->finalizeObject();
+
+    uint64_t main_addr = engine->getFunctionAddress("main");
+    if (!main_addr) {
+        fprintf(diagStream(), "main is not defined\n");
+        SAFE_DELETE(engine);
+        return -1;
+    }
+    int (*main_func)() = (int (*)())main_addr;
+    int result = main_func();
+    fflush(stdout);
+
+    SAFE_DELETE(engine);
+    return result;
+}
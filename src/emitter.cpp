@@ -0,0 +1,291 @@
+// Emitterクラスのメソッドを実装していく
+
+#include "emitter.hpp"
+
+#include<algorithm>
+
+/// コンストラクタ
+/// ホストのターゲットトリプルからTargetMachineを生成し、最適化用のPassBuilderを準備する
+/// InitializeNativeTarget(), InitializeNativeTargetAsmPrinter()を呼んでおくこと
+/// @param 実行ファイルにリンクするランタイムのパス
+Emitter::Emitter(std::string runtime_path)
+    : Machine(NULL), RuntimePath(runtime_path), PassTimes(NULL), Builder(NULL), CustomPipeline(NULL) {
+    std::fill(Pipelines, Pipelines + 4, (llvm::ModulePassManager*)NULL);
+
+    std::string triple = llvm::sys::getDefaultTargetTriple();
+    std::string error;
+    const llvm::Target *target = llvm::TargetRegistry::lookupTarget(triple, error);
+    if (!target) {
+        fprintf(diagStream(), "failed to lookup target %s: %s\n", triple.c_str(), error.c_str());
+    } else {
+        // 実行ファイルはPIEとしてリンクされるので位置独立コードを出力する
+        llvm::TargetOptions options;
+        Machine = target->createTargetMachine(triple, "generic", "", options,
+                                              llvm::Optional<llvm::Reloc::Model>(llvm::Reloc::PIC_));
+    }
+
+    // --time-reportではパスごとの時間を計測する (TimePassesIsEnabledはmainで設定する)
+    if (llvm::TimePassesIsEnabled) {
+        PassTimes = new llvm::TimePassesHandler(true);
+        PassTimes->registerCallbacks(Callbacks);
+    }
+
+    Builder = new llvm::PassBuilder(Machine, llvm::PipelineTuningOptions(), llvm::None, &Callbacks);
+    Builder->registerModuleAnalyses(MAM);
+    Builder->registerCGSCCAnalyses(CGAM);
+    Builder->registerFunctionAnalyses(FAM);
+    Builder->registerLoopAnalyses(LAM);
+    Builder->crossRegisterProxies(LAM, FAM, CGAM, MAM);
+}
+
+/// デストラクタ
+Emitter::~Emitter() {
+    for (int i = 0; i < 4; i++) {
+        SAFE_DELETE(Pipelines[i]);
+    }
+    SAFE_DELETE(CustomPipeline);
+    SAFE_DELETE(Builder);
+    SAFE_DELETE(PassTimes);
+    SAFE_DELETE(Machine);
+}
+
+/// Moduleにターゲットの情報を設定する
+/// 最適化とコード生成がターゲットのデータレイアウトを使えるよう、出力の前に呼ぶ
+/// @param Module
+/// @return 成功時: true, 失敗時: false
+bool Emitter::prepareModule(llvm::Module &mod) {
+    if (!Machine) {
+        return false;
+    }
+    mod.setTargetTriple(Machine->getTargetTriple().str());
+    mod.setDataLayout(Machine->createDataLayout());
+    return true;
+}
+
+/// 最適化パイプラインの取得
+/// 一度構築したパイプラインは保持しておき、次のModuleでも使う
+/// @param 最適化レベル パイプライン文字列(空なら最適化レベルに従う)
+/// @return パイプライン 文字列が不正ならNULL
+llvm::ModulePassManager *Emitter::getPipeline(unsigned level, std::string passes) {
+    if (!passes.empty()) {
+        if (CustomPipeline && CustomPasses == passes) {
+            return CustomPipeline;
+        }
+        SAFE_DELETE(CustomPipeline);
+        llvm::ModulePassManager *mpm = new llvm::ModulePassManager();
+        if (llvm::Error err = Builder->parsePassPipeline(*mpm, passes)) {
+            fprintf(diagStream(), "invalid pass pipeline: %s\n", llvm::toString(std::move(err)).c_str());
+            SAFE_DELETE(mpm);
+            return NULL;
+        }
+        CustomPipeline = mpm;
+        CustomPasses = passes;
+        return CustomPipeline;
+    }
+
+    level = std::min(level, 3u);
+    if (!Pipelines[level]) {
+        const llvm::OptimizationLevel *levels[] = {
+            &llvm::OptimizationLevel::O0,
+            &llvm::OptimizationLevel::O1,
+            &llvm::OptimizationLevel::O2,
+            &llvm::OptimizationLevel::O3,
+        };
+        if (level == 0) {
+            Pipelines[level] = new llvm::ModulePassManager(
+                Builder->buildO0DefaultPipeline(*levels[level]));
+        } else {
+            Pipelines[level] = new llvm::ModulePassManager(
+                Builder->buildPerModuleDefaultPipeline(*levels[level]));
+        }
+    }
+    return Pipelines[level];
+}
+
+/// 新しいPassManagerでModuleを最適化する
+/// 最適化レベルは標準のパイプラインに対応させる
+/// - 0: buildO0DefaultPipeline (CodeGenが適用したmem2reg以外はほぼ何もしない)
+/// - 1から3: buildPerModuleDefaultPipeline(O1からO3)
+/// passesを指定した場合は最適化レベルの代わりにopt -passes=と同じ書式のパイプラインを使う
+/// @param Module 最適化レベル パイプライン文字列(空なら最適化レベルに従う)
+/// @return 成功時: true, 失敗時: false
+bool Emitter::optimizeModule(llvm::Module &mod, unsigned level, std::string passes) {
+    // O0の既定パイプラインではターゲット情報を使わないので、
+    // これまでどおりターゲットに依存しないLLVM-IRを出力できるよう設定しない
+    if ((level > 0 || !passes.empty()) && !prepareModule(mod)) {
+        return false;
+    }
+
+    llvm::ModulePassManager *mpm = getPipeline(level, passes);
+    if (!mpm) {
+        return false;
+    }
+    mpm->run(mod, MAM);
+
+    // 解析結果はこのModuleにしか使えないので破棄する
+    MAM.clear();
+    CGAM.clear();
+    FAM.clear();
+    LAM.clear();
+    return true;
+}
+
+/// パスごとの時間を表示する
+/// 最適化パイプライン(新しいPassManager)の分だけで、コード生成のパスはreportAndResetTimingsで表示する
+void Emitter::printPassTimes() {
+    if (PassTimes) {
+        PassTimes->print();
+    }
+}
+
+/// 指定した形式でModuleをファイルに出力する
+/// @param Module 出力形式 出力先ファイル名
+/// @return 成功時: true, 失敗時: false
+bool Emitter::emitFile(llvm::Module &mod, OutputKind kind, std::string filename) {
+    if (kind != OUTPUT_EXE) {
+        std::error_code ec;
+        llvm::raw_fd_ostream raw_stream(filename, ec,
+            (kind == OUTPUT_IR || kind == OUTPUT_ASM) ? llvm::sys::fs::OF_Text : llvm::sys::fs::OF_None);
+        if (ec) {
+            fprintf(diagStream(), "failed to open %s: %s\n", filename.c_str(), ec.message().c_str());
+            return false;
+        }
+        bool result = emitStream(mod, kind, raw_stream);
+        raw_stream.close();
+        return result;
+    }
+
+    // 実行ファイル 一時ファイルにオブジェクトを出力してからリンクする
+    llvm::SmallString<128> object_file;
+    if (llvm::sys::fs::createTemporaryFile("dcc", "o", object_file)) {
+        fprintf(diagStream(), "failed to create temporary file\n");
+        return false;
+    }
+    bool result = emitFile(mod, OUTPUT_OBJ, object_file.str().str()) &&
+                  linkExecutable(object_file.str().str(), filename);
+    llvm::sys::fs::remove(object_file);
+    return result;
+}
+
+/// 指定した形式でModuleをメモリ上のバッファに出力する
+/// 実行ファイルはリンカを通すため一時ファイルを経由する
+/// @param Module 出力形式 出力先バッファ
+/// @return 成功時: true, 失敗時: false
+bool Emitter::emitBuffer(llvm::Module &mod, OutputKind kind, llvm::SmallVectorImpl<char> &buffer) {
+    if (kind != OUTPUT_EXE) {
+        llvm::raw_svector_ostream stream(buffer);
+        return emitStream(mod, kind, stream);
+    }
+
+    llvm::SmallString<128> exe_file;
+    if (llvm::sys::fs::createTemporaryFile("dcc", "out", exe_file)) {
+        fprintf(diagStream(), "failed to create temporary file\n");
+        return false;
+    }
+    bool result = emitFile(mod, OUTPUT_EXE, exe_file.str().str());
+    if (result) {
+        llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer> > exe = llvm::MemoryBuffer::getFile(exe_file);
+        if (exe) {
+            buffer.append((*exe)->getBufferStart(), (*exe)->getBufferEnd());
+        } else {
+            result = false;
+        }
+    }
+    llvm::sys::fs::remove(exe_file);
+    return result;
+}
+
+/// 指定した形式でModuleをストリームに出力する
+/// @param Module 出力形式(実行ファイル以外) 出力先ストリーム
+/// @return 成功時: true, 失敗時: false
+bool Emitter::emitStream(llvm::Module &mod, OutputKind kind, llvm::raw_pwrite_stream &stream) {
+    if (kind == OUTPUT_IR) {
+        return emitIR(mod, stream);
+    } else if (kind == OUTPUT_BC) {
+        return emitBitcode(mod, stream);
+    } else if (kind == OUTPUT_ASM || kind == OUTPUT_OBJ) {
+        return prepareModule(mod) && emitMachineCode(mod, kind, stream);
+    }
+    return false;
+}
+
+/// LLVM-IRをテキストで出力する
+/// @param Module 出力先ストリーム
+/// @return 成功時: true, 失敗時: false
+bool Emitter::emitIR(llvm::Module &mod, llvm::raw_pwrite_stream &stream) {
+    // PrimtModulePassはPassManagerのaddメソッドで登録、runで適用
+    llvm::legacy::PassManager pm;
+    pm.add(llvm::createPrintModulePass(stream));
+    pm.run(mod);
+    return true;
+}
+
+/// LLVM-IRをBitcodeで出力する
+/// Bitcodeには関数本体の位置を示す索引(VSTの関数エントリ)が書かれるので、
+/// 読み込む側はgetLazyBitcodeModuleで必要な関数だけを実体化できる
+/// あわせてモジュールサマリ(関数ごとの命令数と呼び出し先)を書き出す
+/// 関数ごとの名前表はハッシュ表の順に書かれ、その順序は名前の追加と削除の履歴で変わる
+/// (最適化の途中で消えた名前、キャッシュからの読み込み、並列生成したModuleのリンク)
+/// 同じIRから常に同じバイト列を出力するよう、名前を命令の順に登録し直した複製から書き出す
+/// @param Module 出力先ストリーム
+/// @return 成功時: true, 失敗時: false
+bool Emitter::emitBitcode(llvm::Module &mod, llvm::raw_pwrite_stream &stream) {
+    std::unique_ptr<llvm::Module> copy = llvm::CloneModule(mod);
+
+    // createBitcodeWriterPass(raw_ostream &Str, bool ShouldPreserveUseListOrder,
+    //                         bool EmitSummaryIndex, bool EmitModuleHash)
+    llvm::legacy::PassManager pm;
+    pm.add(llvm::createBitcodeWriterPass(stream, false, true));
+    pm.run(*copy);
+    return true;
+}
+
+/// TargetMachineでアセンブリまたはオブジェクトファイルを出力する
+/// @param Module 出力形式 出力先ストリーム
+/// @return 成功時: true, 失敗時: false
+bool Emitter::emitMachineCode(llvm::Module &mod, OutputKind kind, llvm::raw_pwrite_stream &stream) {
+    // addPassesToEmitFileはコード生成パスを登録できなかった場合にtrueを返す
+    // AsmPrinterは破棄時にストリームへ書き込むので、呼び出し側がストリームを閉じる前に破棄する
+    llvm::legacy::PassManager pm;
+    llvm::CodeGenFileType file_type =
+        kind == OUTPUT_ASM ? llvm::CGFT_AssemblyFile : llvm::CGFT_ObjectFile;
+    if (Machine->addPassesToEmitFile(pm, stream, NULL, file_type)) {
+        fprintf(diagStream(), "target cannot emit this file type\n");
+        return false;
+    }
+    pm.run(mod);
+    return true;
+}
+
+/// オブジェクトファイルとランタイムのアーカイブをリンクして実行ファイルを作る
+/// リンカドライバとしてシステムのccを呼び出す
+/// (リンクできるLLVMにはlldが含まれないので、最後のリンクだけは外部のプロセスで行う)
+/// @param オブジェクトファイル名 出力先ファイル名
+/// @return 成功時: true, 失敗時: false
+bool Emitter::linkExecutable(std::string object_file, std::string filename) {
+    llvm::ErrorOr<std::string> cc = llvm::sys::findProgramByName("cc");
+    if (!cc) {
+        fprintf(diagStream(),
+                "error: --emit=exe links %s with the system C compiler driver, but cc is not found in PATH\n"
+                "       install cc, or emit an object file with -c and link it yourself\n",
+                filename.c_str());
+        return false;
+    }
+
+    // ランタイムをModuleにリンク済みなら、アーカイブからは何も取り出されない
+    std::vector<llvm::StringRef> args;
+    args.push_back(*cc);
+    args.push_back(object_file);
+    if (llvm::sys::fs::exists(RuntimePath)) {
+        args.push_back(RuntimePath);
+    }
+    args.push_back("-o");
+    args.push_back(filename);
+    std::string error;
+    int status = llvm::sys::ExecuteAndWait(*cc, args, llvm::None, {}, 0, 0, &error);
+    if (status != 0) {
+        fprintf(diagStream(), "link failed: %s\n", error.empty() ? "cc returned an error" : error.c_str());
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,173 @@
+#include "generator.hpp"
+
+/// プログラムを生成する
+/// @return 生成した.dcのソース
+std::string SourceGenerator::generate() {
+    State = Config.Seed;
+    Source.clear();
+    for (unsigned i = 0; i < Config.Functions; i++) {
+        generateFunction(i);
+    }
+    generateMain();
+    return Source;
+}
+
+/// 擬似乱数を取得する (線形合同法)
+/// @param 上限(この値は含まない)
+/// @return 0以上上限未満の値
+unsigned SourceGenerator::nextRandom(unsigned bound) {
+    State = State * 1103515245u + 12345u;
+    return bound ? (State >> 16) % bound : 0;
+}
+
+/// 関数を1つ生成する
+/// 代入文はローカル変数に順に代入し、右辺には引数と代入済みの変数、数値を使う
+/// 呼び出し文は自分より前の関数を呼ぶ
+/// @param 関数の番号
+void SourceGenerator::generateFunction(unsigned index) {
+    char buf[64];
+    snprintf(buf, sizeof(buf), "int f%u(int a, int b) {\n", index);
+    Source += buf;
+    for (unsigned i = 0; i < Config.Locals; i++) {
+        snprintf(buf, sizeof(buf), "    int v%u;\n", i);
+        Source += buf;
+    }
+
+    static const char Operators[] = { '+', '-', '*' };
+    unsigned assigned = 0;
+    for (unsigned i = 0; i < Config.Statements && Config.Locals > 0; i++) {
+        snprintf(buf, sizeof(buf), "    v%u = ", i % Config.Locals);
+        Source += buf;
+        generateOperand(assigned);
+        for (unsigned d = 0; d < Config.Depth; d++) {
+            Source += ' ';
+            Source += Operators[nextRandom(3)];
+            Source += ' ';
+            generateOperand(assigned);
+        }
+        Source += ";\n";
+        if (assigned < Config.Locals) {
+            assigned++;
+        }
+    }
+
+    for (unsigned i = 0; i < Config.FanOut && index > 0; i++) {
+        snprintf(buf, sizeof(buf), "    f%u(", nextRandom(index));
+        Source += buf;
+        generateOperand(assigned);
+        Source += ", ";
+        generateOperand(assigned);
+        Source += ");\n";
+    }
+
+    Source += "    return ";
+    generateOperand(assigned);
+    Source += " + b;\n}\n\n";
+}
+
+/// 被演算子を1つ生成する
+/// @param 代入済みのローカル変数の数
+void SourceGenerator::generateOperand(unsigned assigned) {
+    char buf[32];
+    unsigned kind = nextRandom(assigned + 3);
+    if (kind == 0) {
+        Source += 'a';
+    } else if (kind == 1) {
+        Source += 'b';
+    } else if (kind == 2) {
+        snprintf(buf, sizeof(buf), "%u", nextRandom(100));
+        Source += buf;
+    } else {
+        snprintf(buf, sizeof(buf), "v%u", kind - 3);
+        Source += buf;
+    }
+}
+
+/// main関数を生成する
+void SourceGenerator::generateMain() {
+    char buf[64];
+    Source += "int main() {\n    int x;\n    x = 1;\n";
+    if (Config.Functions > 0) {
+        snprintf(buf, sizeof(buf), "    printnum(f%u(x, 2));\n", Config.Functions - 1);
+        Source += buf;
+    }
+    Source += "    return 0;\n}\n";
+}
+
+
+/// 字句解析用入力の名前を取得する
+const char *getLexerInputName(LexerInputKind kind) {
+    switch (kind) {
+        case LEXER_INPUT_WHITESPACE: return "whitespace";
+        case LEXER_INPUT_COMMENT:    return "comment";
+        case LEXER_INPUT_IDENTIFIER: return "identifier";
+        default:                     return "unknown";
+    }
+}
+
+/// 字句解析のマイクロベンチマーク用の入力を生成する
+/// @param 種類 おおよそのバイト数 擬似乱数の種
+/// @return 生成した入力
+std::string generateLexerInput(LexerInputKind kind, size_t bytes, uint32_t seed) {
+    static const char Alnum[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+    static const char Words[] = "lorem ipsum dolor sit amet consectetur adipiscing elit sed do eiusmod ";
+    uint32_t state = seed;
+    // 線形合同法 (SourceGeneratorと同じ系列)
+    auto random = [&state](unsigned bound) {
+        state = state * 1103515245u + 12345u;
+        return (state >> 16) % bound;
+    };
+
+    // 識別子は表への登録が支配的にならないよう、一定の数の中から選ぶ
+    std::vector<std::string> identifiers;
+    if (kind == LEXER_INPUT_IDENTIFIER) {
+        for (unsigned n = 0; n < 4096; n++) {
+            unsigned length = 16 + random(32);
+            std::string name(1, Alnum[random(52)]);
+            for (unsigned i = 1; i < length; i++) {
+                name += Alnum[random(sizeof(Alnum) - 1)];
+            }
+            identifiers.push_back(name);
+        }
+    }
+
+    std::string input;
+    input.reserve(bytes + 4096);
+    while (input.size() < bytes) {
+        if (kind == LEXER_INPUT_WHITESPACE) {
+            // インデントや桁揃えを想定した長い空白
+            input += "x = 1 ;";
+            unsigned spaces = 8 + random(56);
+            for (unsigned i = 0; i < spaces; i++) {
+                input += random(8) ? ' ' : '\t';
+            }
+            if (random(4) == 0) {
+                input += '\n';
+            }
+        } else if (kind == LEXER_INPUT_COMMENT) {
+            // 複数行のブロックコメントと行コメント
+            input += "/*";
+            unsigned lines = 1 + random(8);
+            for (unsigned l = 0; l < lines; l++) {
+                input.append(Words, 16 + random(sizeof(Words) - 17));
+                input += " * ";
+                input.append(Words, 16 + random(sizeof(Words) - 17));
+                input += '\n';
+            }
+            input += "*/\nx = 1; // ";
+            input.append(Words, 16 + random(sizeof(Words) - 17));
+            input += '\n';
+        } else {
+            // 長い識別子と数字
+            input += identifiers[random(identifiers.size())];
+            input += " = ";
+            unsigned digits = 1 + random(9);
+            input += '1' + random(9);
+            for (unsigned i = 1; i < digits; i++) {
+                input += '0' + random(10);
+            }
+            input += ";\n";
+        }
+    }
+    return input;
+}
@@ -1,170 +1,253 @@
 #include "lexer.hpp"
+#include "lextable.hpp"
+
+#include<algorithm>
 
 /// トークン切り出し関数
+/// 入力ファイルを一度だけmmapし、ひと続きのバッファとして走査する
+/// トークンはバッファ上のビューとして切り出すので、識別子や数値はコピーしない
 /// @param 字句解析対象ファイル名
+/// @param 保持するトークン数 (0なら一括して切り出す)
 /// @return 切り出したトークンを格納したTokenStream
-TokenStream *LexicalAnalysis(std::string input_filename) {
-    TokenStream *tokens = new TokenStream();
-    std::ifstream ifs;
-    std::string cur_line;
-    std::string token_str;
-    int line_num = 0;
-    bool iscomment = false;
-
-    ifs.open(input_filename.c_str(), std::ios::in);
-    if (!ifs) {
+TokenStream *LexicalAnalysis(std::string input_filename, TokenIndex window) {
+    // MemoryBuffer::getFileは十分な大きさのファイルをmmapで読み込む
+    // 終端の'\0'を要求するとmmapできない場合があるので要求しない
+    llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer> > buffer =
+        llvm::MemoryBuffer::getFile(input_filename, false, false);
+    if (!buffer) {
         return NULL;
     }
+    return LexicalAnalysis(std::move(*buffer), window);
+}
 
-    while (ifs && getline(ifs, cur_line)) {
-        char next_char;
-        std::string line;
-        Token *next_token;
-        int index = 0;
-        int length = cur_line.length();
-
-        while (index < length) {
-            next_char = cur_line.at(index++);
-
-            // ｺﾒﾝﾄを読み飛ばす
-            if (iscomment) {
-                if ((length - index) < 2
-                    || (cur_line.at(index) != '*')
-                    || (cur_line.at(index++) += '/')) {
-                        continue;
-                } else {
-                    iscomment = false;
-                }
-            }
+/// メモリ上のソースに対するトークン切り出し関数
+/// コンパイルサーバが受け取ったソースなど、ファイルを経由しない入力に使う
+/// @param ソースバッファ
+/// @param 保持するトークン数 (0なら一括して切り出す)
+/// @return 切り出したトークンを格納したTokenStream
+TokenStream *LexicalAnalysis(std::unique_ptr<llvm::MemoryBuffer> source, TokenIndex window) {
+    TokenStream *tokens = new TokenStream(std::move(source), window);
+    if (window == 0) {
+        // 一括モード 先にすべて切り出す
+        while (tokens->fill(tokens->size())) {
+        }
+        if (tokens->hasError()) {
+            SAFE_DELETE(tokens);
+            return NULL;
+        }
+    } else {
+        // ストリーミングモード 先頭のトークンだけ切り出しておく
+        tokens->fill(0);
+    }
+    return tokens;
+}
+
+
+/// コンストラクタ
+/// @param ソースバッファ
+/// @param 保持するトークン数 (0なら無制限) 2のべき乗に切り上げる
+TokenStream::TokenStream(std::unique_ptr<llvm::MemoryBuffer> source, TokenIndex window)
+    : Source(std::move(source)), CurIndex(0), RewindCount(0),
+      Window(0), Mask(~(TokenIndex)0), Produced(0),
+      LexLine(0), LexEnd(false), LexError(false), Scan(getActiveScanKernel()) {
+    LexCur = getSourceBegin();
+    if (window == 0) {
+        LineStarts.push_back(0);
+        return;
+    }
+
+    // 現在のトークンと先読みの1トークンは必ず保持する
+    Window = 4;
+    while (Window < window) {
+        Window <<= 1;
+    }
+    Mask = Window - 1;
+    Types.resize(Window);
+    Offsets.resize(Window);
+    Lengths.resize(Window);
+    Values.resize(Window);
+    Lines.resize(Window);
+}
 
-            if (next_char == EOF) {
-                // EOF
-                token_str = EOF;
-                next_token = new Token(token_str, TOK_EOF, line_num);
 
-            } else if (isspace(next_char)) {
-                // 空白
+/// トークンを1つ格納する
+/// ストリーミングモードでは最も古いトークンの位置を上書きする
+bool TokenStream::pushToken(TokenType type, uint64_t offset, uint32_t length, int value) {
+    if (Window == 0) {
+        Types.push_back(type);
+        Offsets.push_back(offset);
+        Lengths.push_back(length);
+        Values.push_back(value);
+    } else {
+        TokenIndex pos = slot(Produced);
+        Types[pos] = type;
+        Offsets[pos] = offset;
+        Lengths[pos] = length;
+        Values[pos] = value;
+        Lines[pos] = LexLine;
+    }
+    Produced++;
+    return true;
+}
+
+
+/// 改行を見つけたら行数を進める
+/// 一括モードでは次の行の先頭オフセットを行テーブルに登録する
+bool TokenStream::pushLine(uint64_t offset) {
+    LexLine++;
+    if (Window == 0) {
+        LineStarts.push_back(offset);
+    }
+    return true;
+}
+
+
+/// ソースバッファからトークンを1つ切り出す
+/// 末尾に達するか解析不能字句があればEOFトークンを格納する
+/// @return トークンを格納した: true, 既にEOFを格納済み: false
+bool TokenStream::lexToken() {
+    if (LexEnd) {
+        return false;
+    }
+
+    const char *begin = getSourceBegin();
+    const char *end = getSourceEnd();
+    const char *cur = LexCur;
+
+    // 先頭の文字のクラスで動作を決め、'/'だけは次の文字のクラスで決め直す
+    while (cur < end) {
+        const char *token_begin = cur;
+        uint64_t offset = token_begin - begin;
+        char next_char = *cur++;
+        unsigned action = LexTransitions.Actions[LS_START][LexCharClasses.Classes[(unsigned char)next_char]];
+        if (action == LA_SLASH) {
+            unsigned next_class = (cur < end) ? LexCharClasses.Classes[(unsigned char)*cur] : CC_EOF;
+            action = LexTransitions.Actions[LS_SLASH][next_class];
+        }
+
+        switch (action) {
+            case LA_NEWLINE:
+                // 改行 次の行の先頭を行テーブルに登録
+                pushLine(cur - begin);
                 continue;
 
-            } else if (isalpha(next_char)) {
-                // identifier
-                token_str += next_char;
-                next_char = cur_line.at(index++);
-                while (isalnum(next_char)) {
-                    // token_strに文字列を作る
-                    token_str += next_char;
-                    next_char = cur_line.at(index++);
-                    if (index == length)
-                        break;
-                }
-                index--;
+            case LA_SPACE:
+                // 空白 続く空白をまとめて読み飛ばす
+                cur = Scan->SkipSpaces(cur, end);
+                continue;
 
-                if (token_str == "int") {
-                    next_token = new Token(token_str, TOK_INT, line_num);
-                } else if (token_str == "return") {
-                    next_token = new Token(token_str, TOK_RETURN, line_num);
+            case LA_IDENTIFIER: {
+                // 識別子 予約語は完全ハッシュで引く
+                cur = Scan->FindIdentifierEnd(cur, end);
+                size_t length = cur - token_begin;
+                TokenType type = lookupLexKeyword(token_begin, length);
+                if (type == TOK_IDENTIFIER) {
+                    pushToken(TOK_IDENTIFIER, offset, length,
+                              Identifiers.intern(llvm::StringRef(token_begin, length)));
                 } else {
-                    next_token = new Token(token_str, TOK_IDENTIFIER, line_num);
+                    pushToken(type, offset, length);
                 }
+                LexCur = cur;
+                return true;
+            }
 
-            } else if (isdigit(next_char)) {
+            case LA_NUMBER: {
                 // 数字
-                if (next_char == '0') {
-                    token_str += next_char;
-                    next_token = new Token(token_str, TOK_DIGIT, line_num);
-                } else {
-                    token_str += next_char;
-                    next_char = cur_line.at(index++);
-                    while (isdigit(next_char)) {
-                        token_str += next_char;
-                        next_char = cur_line.at(index++);
+                // 終端を求めてから値を求める ("0"はそれだけで1トークン)
+                unsigned int number = next_char - '0';
+                if (next_char != '0') {
+                    const char *digit_end = Scan->FindDigitEnd(cur, end);
+                    while (cur < digit_end) {
+                        number = number * 10 + (*cur++ - '0');
                     }
-                    next_token = new Token(token_str, TOK_DIGIT, line_num);
-                    index--;
                 }
-            } else if (next_char == '/') {
-                // ｺﾒﾝﾄまたは徐算演算子
-                token_str += next_char;
-                next_char = cur_line.at(index++);
-
-                // ｺﾒﾝﾄの場合
-                if (next_char == '/') {
-                    break;
-
-                } else if (next_char == '*') {
-                    // ｺﾒﾝﾄの場合
-                    iscomment = true;
-                    continue;
+                pushToken(TOK_DIGIT, offset, cur - token_begin, (int)number);
+                LexCur = cur;
+                return true;
+            }
 
-                } else {
-                    // 除算演算子
-                    index--;
-                    next_token = new Token(token_str, TOK_SYMBOL, line_num);
-                }
+            case LA_LINE_COMMENT:
+                // 行末までｺﾒﾝﾄ
+                cur = Scan->FindNewline(cur + 1, end);
+                continue;
 
-            } else {
-                // それ以外
-                if (next_char == '*' ||
-                    next_char == '+' ||
-                    next_char == '-' ||
-                    next_char == '=' ||
-                    next_char == ';' ||
-                    next_char == ',' ||
-                    next_char == '(' ||
-                    next_char == ')' ||
-                    next_char == '{' ||
-                    next_char == '}' ){
-                        token_str += next_char;
-                        next_token = new Token(token_str, TOK_SYMBOL, line_num);
-                } else {
-                    // 解析不能字句
-                    fprintf(stderr, "unclear token: %c", next_char);
-                    SAFE_DELETE(tokens);
-                    return NULL;
+            case LA_BLOCK_COMMENT: {
+                // "*/"までｺﾒﾝﾄ 終端を求めてから、途中の改行を行テーブルに登録する
+                cur++;
+                const char *close = Scan->FindCommentEnd(cur, end);
+                for (const char *newline = Scan->FindNewline(cur, close); newline < close;
+                     newline = Scan->FindNewline(newline + 1, close)) {
+                    pushLine(newline + 1 - begin);
                 }
+                cur = (close < end) ? close + 2 : end;
+                continue;
             }
 
-            // Tokensに追加
-            tokens -> pushToken(next_token);
-            token_str.clear();
-        }
-
-        token_str.clear();
-        line_num++;
-    }
+            case LA_SYMBOL:
+            case LA_DIVIDE:
+                // 1文字の記号 (除算演算子を含む)
+                pushToken(TOK_SYMBOL, offset, 1, next_char);
+                LexCur = cur;
+                return true;
 
-    // EOFの確認
-    if (ifs.eof()) {
-        tokens -> pushToken (
-            new Token(token_str, TOK_EOF, line_num)
-        );
+            default:
+                // 解析不能字句 以降は読まずにEOFとする
+                fprintf(diagStream(), "unclear token: %c", next_char);
+                LexError = true;
+                cur = token_begin;
+                break;
+        }
+        break;
     }
 
-    // ｸﾛｰｽﾞ
-    ifs.close();
-    return tokens;
+    // EOF
+    pushToken(TOK_EOF, cur - begin, 0);
+    LexCur = cur;
+    LexEnd = true;
+    return true;
 }
 
 
-/// デストラクタ
-TokenStream::~TokenStream() {
-    for (int i = 0; i < Tokens.size(); i++) {
-        SAFE_DELETE(Tokens[i]);
+/// indexまでのトークンが切り出されているようにする
+/// ストリーミングモードでは現在のトークンを上書きしない範囲でのみ切り出す
+/// @param トークンのインデックス
+/// @return indexのトークンが読み出せる: true, それ以外: false
+bool TokenStream::fill(TokenIndex index) {
+    if (Window != 0 && index >= CurIndex + Window) {
+        return false;
+    }
+    while (Produced <= index) {
+        if (!lexToken()) {
+            return false;
+        }
     }
-    Tokens.clear();
+    return true;
 }
 
+
 /// トークンの取得
-/// @return CureIndex番目のToken
+/// @return CurIndex番目のToken
 Token TokenStream::getToken() {
-    return *Tokens[CurIndex];
+    return Token(getCurRef(), getCurType(), getLine(CurIndex), getCurNumVal());
+}
+
+/// トークンの出現した行数を行テーブルから求める
+/// @param トークンのインデックス
+/// @return 行数(0始まり)
+uint64_t TokenStream::getLine(TokenIndex index) {
+    if (Window != 0) {
+        // ストリーミングモードでは切り出し時に記録した行数を返す
+        return Lines[slot(index)];
+    }
+    std::vector<uint64_t>::iterator line =
+        std::upper_bound(LineStarts.begin(), LineStarts.end(), Offsets[index]);
+    return (line - LineStarts.begin()) - 1;
 }
 
 /// インデックスを1つ増やして次のトークンに進める
 /// @return 成功時: true, 失敗時: false
 bool TokenStream::getNextToken() {
-    int size = Tokens.size();
-    if (--size <= CurIndex) {
+    if (!fill(CurIndex + 1)) {
         return false;
     } else {
         CurIndex++;
@@ -173,9 +256,11 @@ bool TokenStream::getNextToken() {
 }
 
 /// インデックスをtimes回戻す
+/// ストリーミングモードでは上書き済みのトークンまでは戻れない
 bool TokenStream::ungetToken(int times) {
+    RewindCount++;
     for (int i = 0; i < times; i++) {
-        if (CurIndex == 0) {
+        if (CurIndex == 0 || (Window != 0 && CurIndex - 1 + Window < Produced)) {
             return false;
         } else {
             CurIndex--;
@@ -184,15 +269,32 @@ bool TokenStream::ungetToken(int times) {
     return true;
 }
 
+/// インデックスを指定した値に設定
+/// @param トークンのインデックス
+/// @return 成功時: true, 上書き済みまたは未切り出しのトークン: false
+bool TokenStream::applyTokenIndex(TokenIndex index) {
+    if (index < CurIndex) {
+        RewindCount++;
+        if (Window != 0 && index + Window < Produced) {
+            return false;
+        }
+    } else if (!fill(index)) {
+        return false;
+    }
+    CurIndex = index;
+    return true;
+}
+
 /// 格納されたトークン一覧の表示
+/// ストリーミングモードではリングバッファに残っているトークンのみ表示する
 bool TokenStream::printTokens() {
-    std::vector<Token*>::iterator titer = Tokens.begin();
-    while (titer != Tokens.end()) {
-        fprintf(stdout, "%d: ", (*titer) -> getTokenType());
-        if ((*titer) -> getTokenType() != TOK_EOF) {
-            fprintf(stdout, "%s\n", (*titer) -> getTokenString().c_str());
+    TokenIndex first = (Window != 0 && Produced > Window) ? Produced - Window : 0;
+    for (TokenIndex i = first; i < Produced; i++) {
+        TokenIndex pos = slot(i);
+        fprintf(stdout, "%d: ", Types[pos]);
+        if (Types[pos] != TOK_EOF) {
+            fprintf(stdout, "%.*s\n", (int)Lengths[pos], getSourceBegin() + Offsets[pos]);
         }
-        ++titer;
     }
     return true;
 }
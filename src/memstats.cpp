@@ -0,0 +1,244 @@
+// MemoryStatsクラスのメソッドを実装していく
+
+#include "memstats.hpp"
+
+// Nodesの並び AstIDのあとにBaseASTを継承しないASTを並べる
+static const char *NodeNames[] = {
+    "Base", "Variable", "Number", "VariableDecl", "BinaryExpr", "CallExpr", "JumpStmt", "NullExpr",
+    "Prototype", "Function", "FunctionStmt",
+};
+static const unsigned PrototypeIndex = NullExprID + 1;
+static const unsigned FunctionIndex = NullExprID + 2;
+static const unsigned FunctionStmtIndex = NullExprID + 3;
+
+/// フェーズの区切りのRSSを記録する
+/// 現在のRSSは/proc/self/statm、最大RSSはgetrusageから得る
+/// @param フェーズ名
+void MemoryStats::samplePhase(std::string name) {
+    PhaseSample sample;
+    sample.Name = name;
+    sample.RSS = 0;
+    sample.PeakRSS = 0;
+
+    unsigned long long size, resident;
+    FILE *statm = fopen("/proc/self/statm", "r");
+    if (statm) {
+        if (fscanf(statm, "%llu %llu", &size, &resident) == 2) {
+            sample.RSS = resident * sysconf(_SC_PAGESIZE);
+        }
+        fclose(statm);
+    }
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+        sample.PeakRSS = (uint64_t)usage.ru_maxrss * 1024;
+    }
+    // ru_maxrssはカーネルの集計が遅れることがあるので現在のRSSを下限にする
+    if (sample.PeakRSS < sample.RSS) {
+        sample.PeakRSS = sample.RSS;
+    }
+    Phases.push_back(sample);
+}
+
+/// トークンの数と格納に使っているバイト数を記録する
+/// @param トークン数 トークンのバイト数 ソースのバイト数 保持するトークン数(0なら一括)
+void MemoryStats::recordTokens(uint64_t count, uint64_t bytes, uint64_t source_bytes, uint64_t window) {
+    TokenCount = count;
+    TokenBytes = bytes;
+    SourceBytes = source_bytes;
+    TokenWindow = window;
+}
+
+/// 識別子表の大きさを記録する
+/// @param 表の名前 登録数 バイト数
+void MemoryStats::recordSymbolTable(std::string name, uint64_t entries, uint64_t bytes) {
+    Entry entry = {name, entries, bytes};
+    Symbols.push_back(entry);
+}
+
+/// ASTのノードを1つ数える
+void MemoryStats::addNode(unsigned index, uint64_t bytes) {
+    Nodes[index].Count++;
+    Nodes[index].Bytes += bytes;
+}
+
+/// 式、文のASTをたどって数える 子を持つノードは子の配列もバイト数に含める
+void MemoryStats::countNode(BaseAST *node) {
+    if (!node) {
+        return;
+    }
+    if (llvm::isa<VariableAST>(node)) {
+        addNode(VariableID, sizeof(VariableAST));
+    } else if (llvm::isa<NumberAST>(node)) {
+        addNode(NumberID, sizeof(NumberAST));
+    } else if (llvm::isa<VariableDeclAST>(node)) {
+        addNode(VariableDeclID, sizeof(VariableDeclAST));
+    } else if (BinaryExprAST *bin_expr = llvm::dyn_cast<BinaryExprAST>(node)) {
+        addNode(BinaryExprID, sizeof(BinaryExprAST));
+        countNode(bin_expr->getLHS());
+        countNode(bin_expr->getRHS());
+    } else if (CallExprAST *call_expr = llvm::dyn_cast<CallExprAST>(node)) {
+        int i = 0;
+        for (; call_expr->getArgs(i); i++) {
+            countNode(call_expr->getArgs(i));
+        }
+        addNode(CallExprID, sizeof(CallExprAST) + i * sizeof(BaseAST*));
+    } else if (JumpStmtAST *jump_stmt = llvm::dyn_cast<JumpStmtAST>(node)) {
+        addNode(JumpStmtID, sizeof(JumpStmtAST));
+        countNode(jump_stmt->getExpr());
+    } else if (llvm::isa<NullExprAST>(node)) {
+        addNode(NullExprID, sizeof(NullExprAST));
+    }
+}
+
+/// ASTのノード数とバイト数をAstIDごとに記録する
+/// バイト数はノード本体と子の配列の大きさで、アリーナのアラインメントによる隙間は含まない
+/// @param TranslationUnitAST
+void MemoryStats::recordAST(TranslationUnitAST &tunit) {
+    Nodes.clear();
+    for (unsigned i = 0; i < sizeof(NodeNames) / sizeof(NodeNames[0]); i++) {
+        Entry entry = {NodeNames[i], 0, 0};
+        Nodes.push_back(entry);
+    }
+
+    for (int i = 0; i < tunit.getPrototypeNum(); i++) {
+        PrototypeAST *proto = tunit.getPrototype(i);
+        addNode(PrototypeIndex, sizeof(PrototypeAST) + proto->getParamNum() * sizeof(llvm::StringRef));
+    }
+    for (int i = 0; i < tunit.getFunctionNum(); i++) {
+        FunctionAST *func = tunit.getFunction(i);
+        PrototypeAST *proto = func->getPrototype();
+        addNode(PrototypeIndex, sizeof(PrototypeAST) + proto->getParamNum() * sizeof(llvm::StringRef));
+        addNode(FunctionIndex, sizeof(FunctionAST));
+
+        FunctionStmtAST *body = func->getBody();
+        int vdecl_num = 0, stmt_num = 0;
+        for (; body->getVariableDecl(vdecl_num); vdecl_num++) {
+            countNode(body->getVariableDecl(vdecl_num));
+        }
+        for (; body->getStatement(stmt_num); stmt_num++) {
+            countNode(body->getStatement(stmt_num));
+        }
+        addNode(FunctionStmtIndex, sizeof(FunctionStmtAST) + (vdecl_num + stmt_num) * sizeof(void*));
+    }
+
+    ArenaAllocated = tunit.getArena().getAllocatedBytes();
+    ArenaReserved = tunit.getArena().getReservedBytes();
+}
+
+/// Moduleの関数、基本ブロック、命令の数を記録する
+/// @param 記録名 Module
+void MemoryStats::recordModule(std::string name, llvm::Module &mod) {
+    ModuleSample sample = {name, 0, 0, 0};
+    for (llvm::Function &func : mod) {
+        if (func.isDeclaration()) {
+            continue;
+        }
+        sample.Functions++;
+        for (llvm::BasicBlock &block : func) {
+            sample.Blocks++;
+            sample.Instructions += block.size();
+        }
+    }
+    Modules.push_back(sample);
+}
+
+/// 統計をテキストで出力する
+/// @param 出力先
+/// @return 成功時: true, 失敗時: false
+bool MemoryStats::printText(FILE *out) {
+    fprintf(out, "memory stats for %s\n", InputName.c_str());
+    fprintf(out, "  tokens: %llu tokens, %llu bytes (source %llu bytes, window %llu)\n",
+            (unsigned long long)TokenCount, (unsigned long long)TokenBytes,
+            (unsigned long long)SourceBytes, (unsigned long long)TokenWindow);
+    fprintf(out, "  ast: %llu bytes allocated, %llu bytes reserved in arena\n",
+            (unsigned long long)ArenaAllocated, (unsigned long long)ArenaReserved);
+    for (size_t i = 0; i < Nodes.size(); i++) {
+        if (Nodes[i].Count > 0) {
+            fprintf(out, "    %-14s %10llu nodes %12llu bytes\n", Nodes[i].Name.c_str(),
+                    (unsigned long long)Nodes[i].Count, (unsigned long long)Nodes[i].Bytes);
+        }
+    }
+    fprintf(out, "  symbol tables:\n");
+    for (size_t i = 0; i < Symbols.size(); i++) {
+        fprintf(out, "    %-14s %10llu entries %10llu bytes\n", Symbols[i].Name.c_str(),
+                (unsigned long long)Symbols[i].Count, (unsigned long long)Symbols[i].Bytes);
+    }
+    fprintf(out, "  module:\n");
+    for (size_t i = 0; i < Modules.size(); i++) {
+        fprintf(out, "    %-14s %10llu functions %10llu blocks %12llu instructions\n", Modules[i].Name.c_str(),
+                (unsigned long long)Modules[i].Functions, (unsigned long long)Modules[i].Blocks,
+                (unsigned long long)Modules[i].Instructions);
+    }
+    fprintf(out, "  rss after phase:\n");
+    for (size_t i = 0; i < Phases.size(); i++) {
+        fprintf(out, "    %-14s %10.1f MiB (peak %.1f MiB)\n", Phases[i].Name.c_str(),
+                Phases[i].RSS / 1048576.0, Phases[i].PeakRSS / 1048576.0);
+    }
+    return true;
+}
+
+/// 統計をJSONで出力する
+/// @param 出力先ファイル名 ("-"なら標準出力)
+/// @return 成功時: true, 失敗時: false
+bool MemoryStats::writeJSON(std::string filename) {
+    std::error_code ec;
+    llvm::raw_fd_ostream stream(filename, ec, llvm::sys::fs::OF_Text);
+    if (ec) {
+        fprintf(stderr, "failed to open %s: %s\n", filename.c_str(), ec.message().c_str());
+        return false;
+    }
+
+    llvm::json::OStream json(stream, 2);
+    json.object([&] {
+        json.attribute("input", InputName);
+        json.attributeObject("tokens", [&] {
+            json.attribute("count", (int64_t)TokenCount);
+            json.attribute("bytes", (int64_t)TokenBytes);
+            json.attribute("source_bytes", (int64_t)SourceBytes);
+            json.attribute("window", (int64_t)TokenWindow);
+        });
+        json.attributeObject("ast", [&] {
+            json.attribute("arena_allocated", (int64_t)ArenaAllocated);
+            json.attribute("arena_reserved", (int64_t)ArenaReserved);
+            json.attributeObject("nodes", [&] {
+                for (size_t i = 0; i < Nodes.size(); i++) {
+                    if (Nodes[i].Count == 0) {
+                        continue;
+                    }
+                    json.attributeObject(Nodes[i].Name, [&] {
+                        json.attribute("count", (int64_t)Nodes[i].Count);
+                        json.attribute("bytes", (int64_t)Nodes[i].Bytes);
+                    });
+                }
+            });
+        });
+        json.attributeObject("symbols", [&] {
+            for (size_t i = 0; i < Symbols.size(); i++) {
+                json.attributeObject(Symbols[i].Name, [&] {
+                    json.attribute("entries", (int64_t)Symbols[i].Count);
+                    json.attribute("bytes", (int64_t)Symbols[i].Bytes);
+                });
+            }
+        });
+        json.attributeObject("module", [&] {
+            for (size_t i = 0; i < Modules.size(); i++) {
+                json.attributeObject(Modules[i].Name, [&] {
+                    json.attribute("functions", (int64_t)Modules[i].Functions);
+                    json.attribute("blocks", (int64_t)Modules[i].Blocks);
+                    json.attribute("instructions", (int64_t)Modules[i].Instructions);
+                });
+            }
+        });
+        json.attributeArray("phases", [&] {
+            for (size_t i = 0; i < Phases.size(); i++) {
+                json.object([&] {
+                    json.attribute("name", Phases[i].Name);
+                    json.attribute("rss", (int64_t)Phases[i].RSS);
+                    json.attribute("peak_rss", (int64_t)Phases[i].PeakRSS);
+                });
+            }
+        });
+    });
+    stream << "\n";
+    return true;
+}
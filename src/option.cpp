@@ -0,0 +1,192 @@
+// OptionParserクラスのメソッドを実装していく
+
+#include "option.hpp"
+
+/// オプション切り出しメソッド
+/// @return 成功時: True, 失敗時: false
+bool OptionParser::parseOption() {
+    if (Argc < 2) {
+        fprintf(diagStream(), "引数がたりません\n");
+        return false;
+    }
+
+    for (int i = 1; i < Argc; i++) {
+        if (Argv[i][0] == '-' && Argv[i][1] == 'o' && Argv[i][2] == '\0' && i + 1 < Argc) {
+            // output file name
+            OutputFilename.assign(Argv[++i]);
+        } else if (Argv[i][0] == '-' && Argv[i][1] == 'h' && Argv[i][2] == '\0') {
+            printHelp();
+            return false;
+        } else if (Argv[i][0] == '-' && Argv[i][1] == 'O' &&
+                   Argv[i][2] >= '0' && Argv[i][2] <= '3' && Argv[i][3] == '\0') {
+            // 最適化レベル
+            OptLevel = Argv[i][2] - '0';
+        } else if (strncmp(Argv[i], "--passes=", 9) == 0) {
+            // 最適化パイプラインの指定 (opt -passes=と同じ書式)
+            Passes.assign(Argv[i] + 9);
+        } else if (strcmp(Argv[i], "-S") == 0) {
+            // アセンブリを出力
+            Kind = OUTPUT_ASM;
+        } else if (strcmp(Argv[i], "-c") == 0) {
+            // オブジェクトファイルを出力
+            Kind = OUTPUT_OBJ;
+        } else if (strncmp(Argv[i], "--emit=", 7) == 0) {
+            // 出力形式の指定
+            const char *kind = Argv[i] + 7;
+            if (strcmp(kind, "ll") == 0) {
+                Kind = OUTPUT_IR;
+            } else if (strcmp(kind, "bc") == 0) {
+                Kind = OUTPUT_BC;
+            } else if (strcmp(kind, "asm") == 0) {
+                Kind = OUTPUT_ASM;
+            } else if (strcmp(kind, "obj") == 0) {
+                Kind = OUTPUT_OBJ;
+            } else if (strcmp(kind, "exe") == 0) {
+                Kind = OUTPUT_EXE;
+            } else {
+                fprintf(diagStream(), "%s は不明な出力形式です\n", Argv[i]);
+                return false;
+            }
+        } else if (Argv[i][0] == '-' && Argv[i][1] == 'j') {
+            // 並列数 (-j N または -jN)
+            // 入力ファイルが1つなら関数単位のコード生成、複数ならファイル単位のコンパイルを並列化する
+            const char *num = Argv[i][2] != '\0' ? Argv[i] + 2 : (i + 1 < Argc ? Argv[++i] : "");
+            Jobs = strtoul(num, NULL, 10);
+            if (Jobs == 0) {
+                fprintf(diagStream(), "-j の並列数が不正です\n");
+                return false;
+            }
+        } else if (strcmp(Argv[i], "--serve") == 0 && i + 1 < Argc) {
+            // コンパイルサーバとして待ち受けるソケット (-jはワーカ数になる)
+            ServeSocket.assign(Argv[++i]);
+        } else if (strcmp(Argv[i], "--cache-dir") == 0 && i + 1 < Argc) {
+            // コンパイルキャッシュのディレクトリ
+            CacheDir.assign(Argv[++i]);
+        } else if (strncmp(Argv[i], "--cache-dir=", 12) == 0) {
+            CacheDir.assign(Argv[i] + 12);
+        } else if (strncmp(Argv[i], "--cache-max-size=", 17) == 0) {
+            // コンパイルキャッシュの合計サイズの上限 (K, M, Gの接尾辞を付けられる)
+            char *end;
+            CacheMaxSize = strtoull(Argv[i] + 17, &end, 10);
+            if (*end == 'K' || *end == 'k') {
+                CacheMaxSize <<= 10;
+                end++;
+            } else if (*end == 'M' || *end == 'm') {
+                CacheMaxSize <<= 20;
+                end++;
+            } else if (*end == 'G' || *end == 'g') {
+                CacheMaxSize <<= 30;
+                end++;
+            }
+            if (CacheMaxSize == 0 || *end != '\0') {
+                fprintf(diagStream(), "%s のサイズが不正です\n", Argv[i]);
+                return false;
+            }
+        } else if (strcmp(Argv[i], "--cache-stats") == 0) {
+            // コンパイルキャッシュの統計表示
+            CacheStats = true;
+        } else if (strcmp(Argv[i], "--time-report") == 0) {
+            // フェーズごと、関数ごとの時間を表示
+            TimeReport = true;
+        } else if (strncmp(Argv[i], "--trace=", 8) == 0) {
+            // Chrome/Perfetto形式のtime-traceを出力
+            TracePath.assign(Argv[i] + 8);
+        } else if (strcmp(Argv[i], "--mem-stats") == 0) {
+            // メモリ使用量の統計を標準エラーに表示
+            MemStats = true;
+        } else if (strncmp(Argv[i], "--mem-stats=", 12) == 0) {
+            // メモリ使用量の統計をJSONで出力 ("-"なら標準出力)
+            MemStats = true;
+            MemStatsPath.assign(Argv[i] + 12);
+        } else if (strcmp(Argv[i], "--no-runtime") == 0) {
+            // ランタイムをリンクしない
+            NoRuntime = true;
+        } else if (strcmp(Argv[i], "--no-simplify") == 0) {
+            // ASTの簡約を行わない
+            NoSimplify = true;
+        } else if (strcmp(Argv[i], "--simplify-stats") == 0) {
+            // ASTの簡約で取り除いた節点の数を表示
+            SimplifyStats = true;
+        } else if (strcmp(Argv[i], "--ssa") == 0) {
+            // allocaとmem2regを使わずSSA形式を直接生成
+            DirectSSA = true;
+        } else if (strcmp(Argv[i], "--run") == 0) {
+            // JIT実行
+            Run = true;
+        } else if (strcmp(Argv[i], "--arena-stats") == 0) {
+            // Arenaの統計表示
+            ArenaStats = true;
+        } else if (strcmp(Argv[i], "--stream") == 0) {
+            // 字句解析をパーサに合わせて逐次行う
+            TokenWindow = 4096;
+        } else if (strncmp(Argv[i], "--stream=", 9) == 0) {
+            // 保持するトークン数を指定して逐次字句解析
+            TokenWindow = strtoull(Argv[i] + 9, NULL, 10);
+            if (TokenWindow == 0) {
+                fprintf(diagStream(), "%s のトークン数が不正です\n", Argv[i]);
+                return false;
+            }
+        } else if (Argv[i][0] == '-') {
+            fprintf(diagStream(), "%s は不明なオプションです\n", Argv[i]);
+            return false;
+        } else {
+            // inputFilename 複数指定すると-jの数だけ並列にコンパイルする
+            InputFilenames.push_back(Argv[i]);
+        }
+    }
+
+    // サーバは入力ファイルを持たない
+    if (!ServeSocket.empty()) {
+        return true;
+    }
+
+    // 複数のファイルを一度にコンパイルする場合、出力ファイル名は入力ごとに決める
+    if (InputFilenames.size() > 1 && !OutputFilename.empty()) {
+        fprintf(diagStream(), "複数の入力ファイルに -o は指定できません\n");
+        return false;
+    }
+    if (SimplifyStats && NoSimplify) {
+        fprintf(diagStream(), "--simplify-stats と --no-simplify は同時に指定できません\n");
+        return false;
+    }
+    if (CacheStats && CacheDir.empty()) {
+        fprintf(diagStream(), "--cache-stats には --cache-dir が必要です\n");
+        return false;
+    }
+    if (InputFilenames.size() > 1 && TimeReport) {
+        fprintf(diagStream(), "--time-report の入力ファイルは1つだけです\n");
+        return false;
+    }
+    if (InputFilenames.size() > 1 && MemStats) {
+        fprintf(diagStream(), "--mem-stats の入力ファイルは1つだけです\n");
+        return false;
+    }
+    if (InputFilenames.size() > 1 && Run) {
+        fprintf(diagStream(), "--run の入力ファイルは1つだけです\n");
+        return false;
+    }
+    return true;
+}
+
+/// 入力ファイルに対応する出力ファイル名の取得
+/// -oの指定がなければ入力ファイル名の".dc"を出力形式の拡張子に置き換える
+/// @param 入力ファイル名
+/// @return 出力ファイル名
+std::string OptionParser::getOutputFileName(std::string input_filename) {
+    if (!OutputFilename.empty()) {
+        return OutputFilename;
+    }
+
+    const char *ext = Kind == OUTPUT_BC ? ".bc" :
+                      Kind == OUTPUT_ASM ? ".s" :
+                      Kind == OUTPUT_OBJ ? ".o" :
+                      Kind == OUTPUT_EXE ? "" : ".ll";
+    std::string ifn = input_filename;
+    int len = ifn.length();
+    if ((len > 2) && ifn[len - 3] == '.' && ((ifn[len - 2] == 'd' && ifn[len - 1] == 'c'))) {
+        return std::string(ifn.begin(), ifn.end() - 3) + ext;
+    } else if (Kind == OUTPUT_EXE) {
+        return "a.out";
+    }
+    return ifn + ext;
+}
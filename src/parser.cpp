@@ -1,26 +1,51 @@
-#ifndef PARSER_HPP
-#define PARSER_HPP
-
 #include "parser.hpp"
 
 // S: 構文解析メソッドの実装 p.81
 
 /// コンストラクタ
-Parser::Parser(std::string filename) {
+/// @param 入力ファイル名
+/// @param 保持するトークン数 (0ならファイル全体を先に字句解析する)
+Parser::Parser(std::string filename, TokenIndex token_window) : TU(NULL), CurFuncNum(0), Timing(NULL) {
     // TokenStreamクラスのインスタンスをTokensに保存する
-    Tokens = LexicalAnalysis(filename);
+    Tokens = LexicalAnalysis(filename, token_window);
+}
+
+/// コンストラクタ
+/// @param ソースバッファ
+/// @param 保持するトークン数 (0ならソース全体を先に字句解析する)
+Parser::Parser(std::unique_ptr<llvm::MemoryBuffer> source, TokenIndex token_window) : TU(NULL), CurFuncNum(0), Timing(NULL) {
+    Tokens = LexicalAnalysis(std::move(source), token_window);
 }
 
 /// 構文解析実行
 /// @return 解析成功: true, 解析失敗: false
 bool Parser::doParse() {
     if(!Tokens) {
-        fprintf(stderr, "error at lexer\n");
+        fprintf(diagStream(), "error at lexer\n");
         return false;
-    } else {
-        // 構文解析
-        return visitTranslationUnit();
     }
+
+    // 構文解析
+    // ストリーミングモードでは解析不能字句は解析中に見つかりEOFとして扱われる
+    bool result = visitTranslationUnit();
+    if (Tokens->hasError()) {
+        fprintf(diagStream(), "error at lexer\n");
+        return false;
+    }
+    if (!result) {
+        // 巻き戻しを行わないので、解析に失敗した位置が現在のトークンになる
+        fprintf(diagStream(), "syntax error at line %llu\n",
+                (unsigned long long)Tokens->getLine(Tokens->getCurIndex()) + 1);
+        return false;
+    }
+    return true;
+}
+
+/// TokenStreamを巻き戻した回数の取得
+/// 正しい入力は一度も巻き戻さずに解析できる (dcc-parser-testで確認する)
+/// @return 巻き戻した回数 字句解析に失敗していた場合は0
+uint64_t Parser::getRewindCount() {
+    return Tokens ? Tokens->getRewindCount() : 0;
 }
 
 /// ASTの取得
@@ -33,6 +58,101 @@ TranslationUnitAST &Parser::getAST() {
     }
 }
 
+/// トークンと識別子表の大きさをメモリ統計に記録する
+/// @param メモリ統計
+/// @return 成功時: true, 字句解析に失敗していた場合: false
+bool Parser::reportMemory(MemoryStats &stats) {
+    if (!Tokens) {
+        return false;
+    }
+    stats.recordTokens(Tokens->size(), Tokens->getMemorySize(), Tokens->getSourceSize(), Tokens->getWindow());
+
+    IdentifierTable &identifiers = Tokens->getIdentifiers();
+    stats.recordSymbolTable("identifiers", identifiers.size(), identifiers.getMemorySize());
+    stats.recordSymbolTable("names", IdentNames.size(), IdentNames.capacity() * sizeof(llvm::StringRef));
+    stats.recordSymbolTable("variables", VariableTable.size(), VariableTable.capacity() * sizeof(int));
+    stats.recordSymbolTable("prototypes", PrototypeTable.size(), PrototypeTable.capacity() * sizeof(int));
+    stats.recordSymbolTable("functions", FunctionTable.size(), FunctionTable.capacity() * sizeof(int));
+    stats.recordSymbolTable("variable slots", VariableSlots.size(), VariableSlots.capacity() * sizeof(int));
+    stats.recordSymbolTable("function indices", FunctionIndexTable.size(), FunctionIndexTable.capacity() * sizeof(int));
+    return true;
+}
+
+/// 変数が解析中の関数で宣言済みか確認する
+/// @param 識別子ID
+/// @return 宣言済み: true, 未宣言: false
+bool Parser::isDeclaredVariable(int id) {
+    return id >= 0 && id < VariableTable.size() && VariableTable[id] == CurFuncNum;
+}
+
+/// 変数を解析中の関数で宣言済みとして登録する
+/// @param 識別子ID 関数内の変数の番号
+/// @return true
+bool Parser::declareVariable(int id, int slot) {
+    if (id >= VariableTable.size()) {
+        VariableTable.resize(id + 1, -1);
+        VariableSlots.resize(id + 1, -1);
+    }
+    VariableTable[id] = CurFuncNum;
+    VariableSlots[id] = slot;
+    return true;
+}
+
+/// 解析中の関数で宣言された変数の番号を取得する
+/// @param 識別子ID
+/// @return 宣言済み: 変数の番号, 未宣言: -1
+int Parser::lookupVariableSlot(int id) {
+    return isDeclaredVariable(id) ? VariableSlots[id] : -1;
+}
+
+/// 関数の番号を取得する 初めて現れた関数には新しい番号を割り当てる
+/// @param 識別子ID
+/// @return 関数の番号
+int Parser::getFunctionIndex(int id) {
+    int index = lookupSymbol(FunctionIndexTable, id);
+    if (index < 0) {
+        index = TU->newFunctionIndex();
+        registerSymbol(FunctionIndexTable, id, index);
+    }
+    return index;
+}
+
+/// 識別子IDに対応する名前を取得する
+/// 名前はASTと同じArenaへ識別子ごとに一度だけコピーし、以降は使いまわす
+/// @param 識別子ID
+/// @return Arena上の名前
+llvm::StringRef Parser::getIdentName(int id) {
+    if (id >= IdentNames.size()) {
+        IdentNames.resize(id + 1);
+    }
+    if (IdentNames[id].empty()) {
+        IdentNames[id] = TU->getArena().copyString(Tokens->getIdentifiers().getName(id));
+    }
+    return IdentNames[id];
+}
+
+/// プロトタイプ/関数テーブルから引数の数を取得する
+/// @param テーブル 識別子ID
+/// @return 登録済み: 引数の数, 未登録: -1
+int Parser::lookupSymbol(std::vector<int> &table, int id) {
+    if (id >= 0 && id < table.size()) {
+        return table[id];
+    } else {
+        return -1;
+    }
+}
+
+/// プロトタイプ/関数テーブルに(識別子ID, 引数の数)を登録する
+/// @param テーブル 識別子ID 引数の数
+/// @return true
+bool Parser::registerSymbol(std::vector<int> &table, int id, int param_num) {
+    if (id >= table.size()) {
+        table.resize(id + 1, -1);
+    }
+    table[id] = param_num;
+    return true;
+}
+
 // E: 構文解析メソッドの実装 p.81
 
 /// TranslationUnit用構文解析メソッド
@@ -43,12 +163,15 @@ TranslationUnitAST &Parser::getAST() {
 bool Parser::visitTranslationUnit() {
     TU = new TranslationUnitAST();
 
-    std::vector<std::string> param_list;
-    param_list.push_back("i");
+    llvm::StringRef param_list[] = {"i"};
 
     // printnum 宣言の追加をあらかじめする
-    TU->addPrototype(new PrototypeAST("printnum", param_list));
-    PrototypeTable["printnum"] = 1;
+    PrototypeAST *printnum = TU->getArena().create<PrototypeAST>(
+        "printnum", TU->getArena().copyArray(llvm::makeArrayRef(param_list)));
+    int printnum_id = Tokens->getIdentifiers().intern("printnum");
+    printnum->setIndex(getFunctionIndex(printnum_id));
+    TU->addPrototype(printnum);
+    registerSymbol(PrototypeTable, printnum_id, 1);
 
     // ExternalDecl
     while (true) {
@@ -65,21 +188,29 @@ bool Parser::visitTranslationUnit() {
 
 /// ExternalDeclaration用構文解析クラス
 /// 解析したPrototypeとFunctionASTをTranslationUnitに追加
+/// プロトタイプは一度だけ解析し、続くトークンが ';' か '{' かで宣言と定義を振り分ける
 /// @param TranslationUnitAST
-/// @return true
-/// -+-> function_declaration-+->
-///  |                        ^
-///  └-> function_definition -┘
+/// @return 解析成功: true, 解析失敗: false
+/// -> prototype -+-> ; ---------------------+->  (function_declaration)
+///               |                          ^
+///               └-> function_statement ----┘  (function_definition)
 bool Parser::visitExternalDeclaration(TranslationUnitAST *tunit) {
+    PrototypeAST *proto = visitPrototype();
+    if (!proto) {
+        return false;
+    }
+
     // FunctionDeclaration
-    PrototypeAST *proto = visitFunctionDeclaration();
-    if (proto) {
+    if (Tokens->isCurSymbol(';')) {
+        if (!visitFunctionDeclaration(proto)) {
+            return false;
+        }
         tunit->addPrototype(proto);
         return true;
     }
 
-    // FunctionDrfinition
-    FunctionAST *func_def = visitFunctionDefinition();
+    // FunctionDefinition
+    FunctionAST *func_def = visitFunctionDefinition(proto);
     if (func_def) {
         tunit->addFunction(func_def);
         return true;
@@ -87,82 +218,68 @@ bool Parser::visitExternalDeclaration(TranslationUnitAST *tunit) {
     return false;
 }
 
-/// Prototype用構文解析メソッド
-/// @return 解析成功: PrototypeAST 解析失敗: NULL
-PrototypeAST *Parser::visitFunctionDeclaration() {
-    int bkup = Tokens->getCurIndex();
-    PrototypeAST *proto = visitPrototype();
-    if (!proto) {
-        return NULL;
+/// FunctionDeclaration用構文解析メソッド
+/// 解析済みのプロトタイプに続く ';' を読み、プロトタイプ宣言テーブルに登録する
+/// @param 解析済みのPrototypeAST
+/// @return 解析成功: true 解析失敗: false
+bool Parser::visitFunctionDeclaration(PrototypeAST *proto) {
+    // 再定義されていないか確認する処理
+    // 関数がすでに宣言されているかどうか
+    // または関数が定義済み、引数の数があっているかを確認する
+    int func_id = Tokens->getIdentifiers().lookup(proto->getName());
+    int func_param_num = lookupSymbol(FunctionTable, func_id);
+    if (lookupSymbol(PrototypeTable, func_id) >= 0 ||
+       (func_param_num >= 0 && func_param_num != proto->getParamNum())) {
+        // 再定義されているならばエラーメッセージを出す
+        fprintf(diagStream(), "Function: %s is redefined", proto->getName().str().c_str());
+        return false;
     }
+    // (関数名, 引数)のペアをプロトタイプ宣言テーブルに追加
+    registerSymbol(PrototypeTable, func_id, proto->getParamNum());
+    proto->setIndex(getFunctionIndex(func_id));
 
-    // prototype
-    if (Tokens->getCurString() == ";") {
-        // 再定義されていないか確認する処理
-        // 関数がすでに宣言されているかどうか
-        // または関数が定義済み、引数の数があっているかを確認する
-        if (PrototypeTable.find(proto->getName()) != PrototypeTable.end() ||
-           (FunctionTable.find(proto->getName()) != FunctionTable.end() &&
-           FunctionTable[proto->getName()] != proto->getParamNum())) {
-            // 再定義されているならばエラーメッセージを出してNULLを返す
-            fprintf(stderr, "Function: %s is redefined", proto->getName().c_str());
-            SAFE_DELETE(proto);
-            return NULL;
-        }
-        // (関数名, 引数)のペアをプロトタイプ宣言テーブル(Map)に追加
-        PrototypeTable[proto->getName()] = proto->getParamNum();
-        Tokens->getNextToken();
-        return proto;
-    } else {
-        SAFE_DELETE(proto);
-        Tokens->applyTokenIndex(bkup);
-        return NULL;
-    }
+    // ';'
+    Tokens->getNextToken();
+    return true;
 }
 
 /// FunctionDefinition用構文解析メソッド
+/// @param 解析済みのPrototypeAST
 /// @return 解析成功: FunctionAST 解析失敗: NULL
-FunctionAST *Parser::visitFunctionDefinition() {
-    int bkup = Tokens->getCurIndex();
-
-    PrototypeAST *proto = visitPrototype();
-    if(!proto) {
-        return NULL;
-
+FunctionAST *Parser::visitFunctionDefinition(PrototypeAST *proto) {
     // プロトタイプ宣言と違いがないか
     // すでに関数定義が行われていないかを確認
-    } else if ( (PrototypeTable.find(proto->getName()) != PrototypeTable.end() &&
-      PrototypeTable[proto->getName()] != proto->getParamNum() ) ||
-      FunctionTable.find(proto->getName()) != FunctionTable.end() ) {
+    int func_id = Tokens->getIdentifiers().lookup(proto->getName());
+    int proto_param_num = lookupSymbol(PrototypeTable, func_id);
+    if ( (proto_param_num >= 0 && proto_param_num != proto->getParamNum() ) ||
+      lookupSymbol(FunctionTable, func_id) >= 0 ) {
         // エラーメッセージを出してNULLを返す
-        fprintf(stderr, "Function: %s is redefined", proto->getName().c_str());
-        SAFE_DELETE(proto);
+        fprintf(diagStream(), "Function: %s is redefined", proto->getName().str().c_str());
         return NULL;
     }
 
+    TimeScope scope(TimeReport::createParseTimer(Timing, proto->getName()), "ParseFunction", proto->getName());
+
     // 関数ごとに宣言済み変数を登録する
-    // FunctionStatementの解析前に毎回クリアする
-    VariableTable.clear();
+    // FunctionStatementの解析前に関数の番号を進めて、宣言済み変数をすべて無効にする
+    CurFuncNum++;
     FunctionStmtAST *func_stmt = visitFunctionStatement(proto);
-    if (func_stmt) {
-        // (関数名, 引数の数)のペアを関数テーブル(Map)に追加
-        FunctionTable[proto->getName()] = proto->getParamNum();
-        return new FunctionAST(proto, func_stmt);
-    } else {
-        SAFE_DELETE(proto);
-        Tokens->applyTokenIndex(bkup);
+    if (!func_stmt) {
         return NULL;
     }
+
+    // (関数名, 引数の数)のペアを関数テーブルに追加
+    registerSymbol(FunctionTable, func_id, proto->getParamNum());
+    proto->setIndex(getFunctionIndex(func_id));
+    return TU->getArena().create<FunctionAST>(proto, func_stmt);
 }
 
 /// Prototype用構文解析メソッド
-/// @return 解析成功: FunctionAST 解析失敗: NULL
+/// @return 解析成功: PrototypeAST 解析失敗: NULL
 ///->int->identifier->( -+-> parameter -+-> ) ->
 ///                      ^----- , <-----┘
 PrototypeAST *Parser::visitPrototype() {
-    // bkup index
-    int bkup = Tokens->getCurIndex();
-    std::string func_name;
+    llvm::StringRef func_name;
 
     // プロトタイプ宣言の詳細をとってくる
     //type_specifier
@@ -174,28 +291,27 @@ PrototypeAST *Parser::visitPrototype() {
 
     //IDENTIFIER
     if(Tokens->getCurType()==TOK_IDENTIFIER){
-        func_name=Tokens->getCurString();
+        func_name=getIdentName(Tokens->getCurIdent());
         Tokens->getNextToken();
     }else{
-        Tokens->ungetToken(1);  //unget TOK_INT
         return NULL;
     }
 
     //'('
-    if(Tokens->getCurString()=="("){
+    if(Tokens->isCurSymbol('(')){
         Tokens->getNextToken();
     }else{
-        Tokens->ungetToken(2);	//unget TOK_INT IDENTIFIER
         return NULL;
     }
 
     // parameter_list
     bool is_first_param = true;
-    std::vector<std::string> param_list;
+    llvm::SmallVector<llvm::StringRef, 8> param_list;
+    llvm::SmallVector<int, 8> param_ids;
     while (true)
     {
         // ,
-        if (!is_first_param && Tokens->getCurType() == TOK_SYMBOL && Tokens->getCurString() == ",") {
+        if (!is_first_param && Tokens->isCurSymbol(',')) {
             Tokens->getNextToken();
         }
         if (Tokens->getCurType() == TOK_INT) {
@@ -206,184 +322,224 @@ PrototypeAST *Parser::visitPrototype() {
 
         if (Tokens->getCurType() == TOK_IDENTIFIER) {
             // 引数名に重複がないかを確認
-            // param_list(引数名を格納したリスト)に読み取った識別子が存在するか
-            if (std::find(param_list.begin(), param_list.end(), Tokens->getCurString()) != param_list.end()) {
-                Tokens->applyTokenIndex(bkup);
+            // param_ids(引数の識別子IDを格納したリスト)に読み取った識別子が存在するか
+            if (std::find(param_ids.begin(), param_ids.end(), Tokens->getCurIdent()) != param_ids.end()) {
                 return NULL;
             }
             // 存在しなければリストに識別子を追加する
-            param_list.push_back(Tokens->getCurString());
+            param_ids.push_back(Tokens->getCurIdent());
+            param_list.push_back(getIdentName(Tokens->getCurIdent()));
             Tokens->getNextToken();
         } else {
-            Tokens->applyTokenIndex(bkup);
             return NULL;
         }
         is_first_param = false;
     }
 
     //')'
-    if(Tokens->getCurString()==")"){
+    if(Tokens->isCurSymbol(')')){
         Tokens->getNextToken();
-        return new PrototypeAST(func_name, param_list);
+        return TU->getArena().create<PrototypeAST>(
+            func_name, TU->getArena().copyArray(llvm::makeArrayRef(param_list)));
     }else{
-        Tokens->applyTokenIndex(bkup);
         return NULL;
     }
 }
 
 /// FunctionStatement用解析メソッド
+/// 変数宣言は先頭の 'int' で、ステートメントリストの終わりは '}' で判別する
 /// @param 関数名や引数を格納したPrototypeクラスのインスタンス
 /// @return 解析成功: FunctionStmtAST, 解析失敗: NULL
 /// Function_statement: 変数宣言のリストと式のリストを含む関数ブロックを表す非終端記号
-/// functionStatementを受け入れるために visitFunctionStatement
+/// -> { -+-------------------------------+-+-> statement -+-> } ->
+///       ^                               | ^              |
+///       └-- variable_declaration <------┘ └--------------┘
 FunctionStmtAST *Parser::visitFunctionStatement(PrototypeAST *proto) {
-    int bkup = Tokens->getCurIndex();
-
-    if (Tokens->getCurString() == "{") {
+    if (Tokens->isCurSymbol('{')) {
         Tokens->getNextToken();
     } else {
         return NULL;
     }
 
-    FunctionStmtAST *func_stmt = new FunctionStmtAST();
+    // 変数宣言とステートメントを集めておき、最後にArenaへコピーしてFunctionStmtASTを作る
+    llvm::SmallVector<VariableDeclAST*, 16> var_decls;
+    llvm::SmallVector<BaseAST*, 32> stmts;
 
     // 引数をfunc_stmtの変数宣言リストに追加
     for (int i = 0; i < proto->getParamNum(); i++) {
-        VariableDeclAST *vdecl = new VariableDeclAST(proto->getParamName(i));
+        VariableDeclAST *vdecl = TU->getArena().create<VariableDeclAST>(proto->getParamName(i));
         vdecl->setDeclType(VariableDeclAST::param);
-        func_stmt->addVariableDeclaration(vdecl);
-        VariableTable.push_back(vdecl->getName());
+        vdecl->setSlot(var_decls.size());
+        var_decls.push_back(vdecl);
+        declareVariable(Tokens->getIdentifiers().lookup(vdecl->getName()), vdecl->getSlot());
     }
 
-    VariableDeclAST *var_decl;
-    BaseAST *stmt;
-    BaseAST *last_stmt;
-
-    // {statement_list}
-    if (stmt = visitStatement()){
-        while (stmt) {
-            last_stmt = stmt;
-            func_stmt->addStatement(stmt);
-            stmt = visitStatement();
-        }
-
     // variable_declaration_list
-    } else if (var_decl = visitVariableDeclaration()) {
-        while (var_decl){
-            var_decl->setDeclType(VariableDeclAST::local);
-
-            // 変数の2重宣言チェック
-            if(std::find(VariableTable.begin(), VariableTable.end(), var_decl->getName()) != VariableTable.end()){
-                SAFE_DELETE(var_decl);
-                SAFE_DELETE(func_stmt);
-                return NULL;
-            }
-            // 変数名テーブルに新しく読み取った変数名を追加
-            VariableTable.push_back(var_decl->getName());
-            func_stmt->addVariableDeclaration(var_decl);
-            // parse Variable Delaration
-            var_decl = visitVariableDeclaration();
+    while (Tokens->getCurType() == TOK_INT) {
+        VariableDeclAST *var_decl = visitVariableDeclaration();
+        if (!var_decl) {
+            return NULL;
         }
+        var_decl->setDeclType(VariableDeclAST::local);
 
-        if (stmt = visitStatement()) {
-            while (stmt) {
-                last_stmt = stmt;
-                func_stmt->addStatement(stmt);
-                stmt = visitStatement();
-            }
+        // 変数の2重宣言チェック
+        int var_id = Tokens->getIdentifiers().lookup(var_decl->getName());
+        if(isDeclaredVariable(var_id)){
+            return NULL;
         }
+        // 変数名テーブルに新しく読み取った変数名を追加
+        var_decl->setSlot(var_decls.size());
+        declareVariable(var_id, var_decl->getSlot());
+        var_decls.push_back(var_decl);
+    }
 
-    // other
-    } else {
-        SAFE_DELETE(func_stmt);
-        Tokens->applyTokenIndex(bkup);
-        return NULL;
+    // statement_list
+    BaseAST *last_stmt = NULL;
+    while (!Tokens->isCurSymbol('}')) {
+        BaseAST *stmt = visitStatement();
+        if (!stmt) {
+            return NULL;
+        }
+        last_stmt = stmt;
+        stmts.push_back(stmt);
     }
 
     // 戻り値の確認
     // 最後のstatementがjumpstatementであるかを確認
     if (!last_stmt || !llvm::isa<JumpStmtAST>(last_stmt)) {
-        SAFE_DELETE(func_stmt);
-        Tokens->applyTokenIndex(bkup);
         return NULL;
     }
 
-    if (Tokens->getCurString() == "}") {
-        Tokens->getNextToken();
-        return func_stmt;
-    } else {
-        SAFE_DELETE(func_stmt);
-        Tokens->applyTokenIndex(bkup);
-        return NULL;
-    }
+    // '}'
+    Tokens->getNextToken();
+    return TU->getArena().create<FunctionStmtAST>(
+        TU->getArena().copyArray(llvm::makeArrayRef(var_decls)),
+        TU->getArena().copyArray(llvm::makeArrayRef(stmts)));
 }
 
 /// AssignmentExpression(代入文)用構文解析メソッド
 /// 非終端記号assignment_expressionの解析
+/// 識別子の次のトークンを1つ先読みして代入文かどうかを決めるので、巻き戻しは行わない
 /// @return 解析成功: AST, 解析失敗: NULL
 /// -+-> identifier -> = -> additive_expression -+->
 ///  |                                           ^
 ///  └-> additive_exprssion----------------------┘
 BaseAST *Parser::visitAssignmentExpression() {
-    int bkup = Tokens->getCurIndex();
-
-    BaseAST *lhs;
-    if (Tokens->getCurType() == TOK_IDENTIFIER) {
+    // identifier = additive_expression
+    if (Tokens->getCurType() == TOK_IDENTIFIER && Tokens->isNextSymbol('=')) {
         // 変数宣言の確認
         // 左辺の代入される変数は宣言済みの変数であることを確認
-        if (std::find(VariableTable.begin(), VariableTable.end(), Tokens->getCurString()) != VariableTable.end()) {
-            // 左辺値: 識別子(変数名)
-            lhs = new VariableAST(Tokens->getCurString());
-            Tokens->getNextToken();
-            BaseAST *rhs;
-
-            if (Tokens->getCurType() == TOK_SYMBOL && Tokens->getCurString() == "=") {
-                Tokens->getNextToken();
-                if (rhs = visitAdditiveExpression(NULL)) {
-                    return new BinaryExprAST("=", lhs, rhs);
-                } else {
-                    SAFE_DELETE(lhs);
-                    Tokens->applyTokenIndex(bkup);
-                }
-            } else {
-                SAFE_DELETE(lhs);
-                Tokens->applyTokenIndex(bkup);
-            }
-        } else {
-            Tokens->applyTokenIndex(bkup);
+        if (!isDeclaredVariable(Tokens->getCurIdent())) {
+            return NULL;
         }
+        // 左辺値: 識別子(変数名)
+        BaseAST *lhs = TU->getArena().create<VariableAST>(getIdentName(Tokens->getCurIdent()),
+                                                         lookupVariableSlot(Tokens->getCurIdent()));
+        Tokens->getNextToken();
+        Tokens->getNextToken();
+
+        BaseAST *rhs = visitBinaryExpression(0);
+        if (!rhs) {
+            return NULL;
+        }
+        return TU->getArena().create<BinaryExprAST>("=", lhs, rhs);
     }
 
-    BaseAST *add_expr = visitAdditiveExpression(NULL);
-    if (add_expr) {
-        return add_expr;
+    // additive_expression
+    return visitBinaryExpression(0);
+}
+
+/// 二項演算子の優先順位を取得する
+/// @return 現在のトークンが二項演算子: 優先順位, それ以外: -1
+int Parser::getBinaryPrecedence() {
+    if (Tokens->getCurType() != TOK_SYMBOL) {
+        return -1;
+    }
+    switch (Tokens->getCurNumVal()) {
+        case '+':
+        case '-':
+            return 10;
+        case '*':
+        case '/':
+            return 20;
+        default:
+            return -1;
+    }
+}
+
+/// 演算子の文字列表現を取得する
+/// @param 演算子の文字
+/// @return BinaryExprASTに持たせる文字列
+static llvm::StringRef getBinaryOperator(int op) {
+    switch (op) {
+        case '+': return "+";
+        case '-': return "-";
+        case '*': return "*";
+        case '/': return "/";
+        default:  return "";
+    }
+}
+
+/// 二項演算(additive_expression, multiplicative_expression)用構文解析メソッド
+/// 優先順位法(precedence climbing)で解析する
+/// 1トークン先読みだけで進め、TokenStreamは巻き戻さない
+/// @param この呼び出しで結合する演算子の最低優先順位
+/// @return 解析成功: AST, 解析失敗: NULL
+/// additive_expression:
+/// -> multiplicative_expression -+-> + -+-> multiplicative_expression -+->
+///                               ^  └-> - -┘                            |
+///                               └--------------------------------------┘
+/// multiplicative_expression:
+/// -> postfix_expression -+-> * -+-> postfix_expression -+->
+///                        ^  └-> / -┘                     |
+///                        └-------------------------------┘
+BaseAST *Parser::visitBinaryExpression(int min_prec) {
+    // 左辺値の取得
+    BaseAST *lhs = visitPostfixExpression();
+    if (!lhs) {
+        return NULL;
+    }
+
+    while (true) {
+        // 優先順位がmin_prec未満の演算子(もしくは演算子以外)が来たら呼び出し元に返す
+        int prec = getBinaryPrecedence();
+        if (prec < 0 || prec < min_prec) {
+            return lhs;
+        }
+        llvm::StringRef op = getBinaryOperator(Tokens->getCurNumVal());
+        Tokens->getNextToken();
+
+        // 右辺値の取得
+        // 同じ優先順位の演算子は左結合にするためprec+1以上の演算子だけを右辺に取り込む
+        BaseAST *rhs = visitBinaryExpression(prec + 1);
+        if (!rhs) {
+            return NULL;
+        }
+        lhs = TU->getArena().create<BinaryExprAST>(op, lhs, rhs);
     }
-    return NULL;
 }
 
 /// Primary_expression(式の基本構成要素)用構文解析メソッド
 /// 識別子や数値、()で囲まれた式を処理する
 /// @return 解析成功時: AST, 解析失敗: NULL
 BaseAST *Parser::visitPrimaryExpression() {
-    // record index
-    int bkup = Tokens->getCurIndex();
-
     // 変数が宣言されていることを確認
     // VARIABLE_IDENTIFIER
     if (Tokens->getCurType() == TOK_IDENTIFIER &&
-        std::find(VariableTable.begin(), VariableTable.end(), Tokens->getCurString()) != VariableTable.end()) {
-        std::string var_name = Tokens->getCurString();
+        isDeclaredVariable(Tokens->getCurIdent())) {
+        llvm::StringRef var_name = getIdentName(Tokens->getCurIdent());
+        int slot = lookupVariableSlot(Tokens->getCurIdent());
         Tokens->getNextToken();
-        return new VariableAST(var_name);
+        return TU->getArena().create<VariableAST>(var_name, slot);
 
     // integer
     } else if (Tokens->getCurType() == TOK_DIGIT) {
         int val = Tokens->getCurNumVal();
         Tokens->getNextToken();
-        return new NumberAST(val);
+        return TU->getArena().create<NumberAST>(val);
     
     // integer(-)
-    } else if (Tokens->getCurType() == TOK_SYMBOL && Tokens->getCurString() == "-") {
+    } else if (Tokens->isCurSymbol('-')) {
         // TODO: 負数の処理 p92
     }
     // TODO: '(', ')' expression
@@ -400,189 +556,64 @@ BaseAST *Parser::visitPrimaryExpression() {
 ///                       ^                          |
 ///                       └------- , --------------- ┘
 BaseAST *Parser::visitPostfixExpression() {
-    // get index
-    int bkup = Tokens->getCurIndex();
-
-    // primary_expression
-    BaseAST *prim_expr = visitPrimaryExpression();
-    if (prim_expr){
-        return prim_expr;
+    // FUNCTION_IDENTIFIER
+    // 宣言済みの変数名でなく、関数として宣言されている識別子なら関数呼び出し
+    if (Tokens->getCurType() != TOK_IDENTIFIER || isDeclaredVariable(Tokens->getCurIdent())) {
+        // primary_expression
+        return visitPrimaryExpression();
     }
 
-    // FUNCTION_IDENTIFIER
-    if (Tokens->getCurType() == TOK_IDENTIFIER) {
-        int param_num;
-        // 関数宣言の確認
-        // プロトタイプ宣言されているか確認し、引数の数をテーブルから取得
-        if (PrototypeTable.find(Tokens->getCurString()) != PrototypeTable.end()) {
-            param_num = PrototypeTable[Tokens->getCurString()];
-        } else if (FunctionTable.find(Tokens->getCurString()) != FunctionTable.end()) {
-            param_num = FunctionTable[Tokens->getCurString()];
-        } else {
-            return NULL;
-        }
+    int param_num;
+    // 関数宣言の確認
+    // プロトタイプ宣言されているか確認し、引数の数をテーブルから取得
+    if ((param_num = lookupSymbol(PrototypeTable, Tokens->getCurIdent())) < 0 &&
+        (param_num = lookupSymbol(FunctionTable, Tokens->getCurIdent())) < 0) {
+        return NULL;
+    }
 
-        // 関数名取得
-        std::string Callee = Tokens->getCurString();
-        Tokens->getNextToken();
+    // 関数名と関数の番号の取得
+    llvm::StringRef Callee = getIdentName(Tokens->getCurIdent());
+    int callee_index = lookupSymbol(FunctionIndexTable, Tokens->getCurIdent());
+    Tokens->getNextToken();
 
-        // LEFT PARENの存在確認
-        if (Tokens->getCurType() != TOK_SYMBOL || Tokens->getCurString() != "(") {
-            Tokens->applyTokenIndex(bkup);
-            return NULL;
-        }
+    // LEFT PARENの存在確認
+    if (!Tokens->isCurSymbol('(')) {
+        return NULL;
+    }
+    Tokens->getNextToken();
 
-        Tokens->getNextToken();
-        // 解析に成功した引数を格納するベクタ
-        std::vector<BaseAST*> args;
+    // 解析に成功した引数を格納するベクタ
+    llvm::SmallVector<BaseAST*, 8> args;
 
-        // 引数の解析
-        BaseAST *assign_expr = visitAssignmentExpression();
-        if (assign_expr) {
+    // 引数の解析
+    if (!Tokens->isCurSymbol(')')) {
+        while (true) {
+            BaseAST *assign_expr = visitAssignmentExpression();
+            if (!assign_expr) {
+                return NULL;
+            }
             args.push_back(assign_expr);
 
             // "," が続く間続ける
-            while (Tokens->getCurType() == TOK_SYMBOL && Tokens->getCurString() == ",") {
-                Tokens->getNextToken();
-
-                // IDENTIFIER
-                assign_expr = visitAssignmentExpression();
-                if (assign_expr) {
-                    args.push_back(assign_expr);
-                } else {
-                    break;
-                }
-            }
-        }
-
-        // 引数の数を確認する
-        if (args.size() != param_num) {
-            for (int i = 0; i < args.size(); i++) {
-                SAFE_DELETE(args[i]);
+            if (!Tokens->isCurSymbol(',')) {
+                break;
             }
-            Tokens->applyTokenIndex(bkup);
-            return NULL;
-        }
-
-        // RIGHT PALENの確認
-        if (Tokens->getCurType() == TOK_SYMBOL && Tokens->getCurString() == ")") {
             Tokens->getNextToken();
-            return new CallExprAST(Callee, args);
-        } else {
-            // 復帰処理
-            for (int i = 0; i < args.size(); i++) {
-                SAFE_DELETE(args[i]);
-            }
-            Tokens->applyTokenIndex(bkup);
-            return NULL;
         }
-    } else {
-        return NULL;
     }
-}
 
-/// Additive_expression(加減算)用構文解析メソッド
-/// @param lhs(左辺) 初回呼び出しはNULL
-/// @return 解析成功: AST、解析失敗: NULL
-/// -> multiplicative_expression -+-------------------------+->
-///                               |                         ^
-///         +---------------------+                         |
-///         |                                               |
-///         +---+--+-> + +> multiplicative_expression +-+-+-+
-///             ^  |                                    ^ |
-///             |  +-> - +> multiplicative_expression +-+ |
-///             |                                         |
-///             +-----------------------------------------+
-BaseAST *Parser::visitAdditiveExpression(BaseAST *lhs) {
-    int bkup = Tokens->getCurIndex();
-
-    // 左辺値の取得
-    if (!lhs) {
-        lhs = visitMultiplicativeExpression(NULL);
-    }
-
-    if (!lhs) {
+    // 引数の数を確認する
+    if (args.size() != param_num) {
         return NULL;
     }
 
-    BaseAST *rhs;
-    // + 演算子の取得
-    if (Tokens->getCurType() == TOK_SYMBOL && Tokens->getCurString() == "+") {
-        Tokens->getNextToken();
-        // 右辺値の取得
-        rhs = visitMultiplicativeExpression(NULL);
-        if (rhs) {
-            // 再帰的に呼び出して後続の演算も見る
-            return visitAdditiveExpression(
-                new BinaryExprAST("+", lhs, rhs)
-            );
-        } else {
-            SAFE_DELETE(lhs);
-            Tokens->applyTokenIndex(bkup);
-            return NULL;
-        }
-
-    // - 演算子の取得
-    } else if (Tokens->getCurType() == TOK_SYMBOL && Tokens->getCurString() == "-") {
-        Tokens->getNextToken();
-        // 右辺値の取得
-        rhs = visitMultiplicativeExpression(NULL);
-        if (rhs) {
-            return visitAdditiveExpression(
-                new BinaryExprAST("+", lhs, rhs)
-            );
-        } else {
-            SAFE_DELETE(lhs);
-            Tokens->applyTokenIndex(bkup);
-            return NULL;
-        }
-    }
-    return lhs;
-}
-
-/// MultiplicativeExpression用解析メソッド
-/// @param lhs(左辺) 初回呼び出しはNULL
-/// @return 解析成功: AST, 解析失敗: NULL
-BaseAST *Parser::visitMultiplicativeExpression(BaseAST *lhs) {
-    int bkup = Tokens->getCurIndex();
-
-    // BaseAST *lhs = visitPostfixExpression();
-    if (!lhs) {
-        lhs = visitPostfixExpression();
-    }
-    BaseAST *rhs;
-
-    if (!lhs) {
+    // RIGHT PALENの確認
+    if (!Tokens->isCurSymbol(')')) {
         return NULL;
     }
-
-    // *
-    if (Tokens->getCurType() == TOK_SYMBOL && Tokens->getCurString() == "*") {
-        Tokens->getNextToken();
-        rhs = visitPostfixExpression();
-
-        if (rhs) {
-            return visitMultiplicativeExpression(new BinaryExprAST("*", lhs, rhs));
-        } else {
-            SAFE_DELETE(lhs);
-            Tokens->applyTokenIndex(bkup);
-            return NULL;
-        }
-
-    // /
-    } else if (Tokens->getCurType() == TOK_SYMBOL && Tokens->getCurString() == "/") {
-        Tokens->getNextToken();
-        rhs = visitPostfixExpression();
-
-        if (rhs) {
-            return visitMultiplicativeExpression(new BinaryExprAST("/", lhs, rhs));
-        } else {
-            SAFE_DELETE(lhs);
-            Tokens->applyTokenIndex(bkup);
-            return NULL;
-        }
-    }
-    return lhs;
+    Tokens->getNextToken();
+    return TU->getArena().create<CallExprAST>(
+        Callee, callee_index, TU->getArena().copyArray(llvm::makeArrayRef(args)));
 }
 
 // なんか実装し忘れてたメソッドたちを追加していく
@@ -593,11 +624,11 @@ BaseAST *Parser::visitExpressionStatement() {
     BaseAST *assign_expr;
 
     // NULL Expression
-    if (Tokens->getCurString() == ";") {
+    if (Tokens->isCurSymbol(';')) {
         Tokens->getNextToken();
-        return new NullExprAST();
+        return TU->getArena().create<NullExprAST>();
     } else if (assign_expr = visitAssignmentExpression()) {
-        if (Tokens->getCurString() == ";") {
+        if (Tokens->isCurSymbol(';')) {
             Tokens->getNextToken();
             return assign_expr;
         }
@@ -605,21 +636,21 @@ BaseAST *Parser::visitExpressionStatement() {
     return NULL;
 }
 
+/// Statement用構文解析メソッド
+/// 先頭のトークンで jump_statement と expression_statement を振り分ける
+/// @return 解析成功: AST, 解析失敗: NULL
 BaseAST *Parser::visitStatement() {
-    BaseAST *stmt = NULL;
-    if (stmt = visitExpressionStatement()) {
-        return stmt;
-    } else if (stmt = visitJumpStatement()) {
-        return stmt;
+    if (Tokens->getCurType() == TOK_RETURN) {
+        return visitJumpStatement();
     } else {
-        return NULL;
+        return visitExpressionStatement();
     }
 }
 
 /// VariableDeclaration用構文解析メソッド
 /// @return 解析成功: VariableDeclAST, 解析失敗: NULL
 VariableDeclAST *Parser::visitVariableDeclaration() {
-    std::string name;
+    llvm::StringRef name;
 
     // INT
     if (Tokens->getCurType() == TOK_INT) {
@@ -630,19 +661,17 @@ VariableDeclAST *Parser::visitVariableDeclaration() {
 
     // IDENTIFIER
     if (Tokens->getCurType() == TOK_IDENTIFIER) {
-        name = Tokens->getCurString();
+        name = getIdentName(Tokens->getCurIdent());
         Tokens->getNextToken();
     } else {
-        Tokens->ungetToken(1);
         return NULL;
     }
 
     // ';'
-    if (Tokens->getCurString() == ";") {
+    if (Tokens->isCurSymbol(';')) {
         Tokens->getNextToken();
-        return new VariableDeclAST(name);
+        return TU->getArena().create<VariableDeclAST>(name);
     } else {
-        Tokens->ungetToken(2);
         return NULL;
     }
 }
@@ -650,26 +679,21 @@ VariableDeclAST *Parser::visitVariableDeclaration() {
 /// JumpStatement用構文解析メソッド
 /// @return 解析成功: AST 解析失敗: NULL
 BaseAST *Parser::visitJumpStatement() {
-    int bkup = Tokens->getCurIndex();
     BaseAST *expr;
 
     if (Tokens->getCurType() == TOK_RETURN) {
         Tokens->getNextToken();
         if (!(expr = visitAssignmentExpression())) {
-            Tokens->applyTokenIndex(bkup);
             return NULL;
         }
 
-        if (Tokens->getCurString() == ";") {
+        if (Tokens->isCurSymbol(';')) {
             Tokens->getNextToken();
-            return new JumpStmtAST(expr);
+            return TU->getArena().create<JumpStmtAST>(expr);
         } else {
-            Tokens->applyTokenIndex(bkup);
             return NULL;
         }
     } else {
         return NULL;
     }
 }
-
-#endif
\ No newline at end of file
@@ -0,0 +1,140 @@
+// 構文解析のテスト (dcc-parser-test)
+// 正しい入力を一括の字句解析と逐次字句解析(--stream)の両方で解析し、
+// 解析に成功することと、TokenStreamを一度も巻き戻さないことを確認する
+// 誤りのある入力は解析に失敗することも確認する
+//
+// usage: dcc-parser-test [file.dc ...]
+//        指定したファイルは正しい入力として組み込みの入力に加えて解析する
+
+#include<cstdio>
+#include<string>
+#include<vector>
+#include<llvm/Support/MemoryBuffer.h>
+
+#include "generator.hpp"
+#include "parser.hpp"
+
+/// 組み込みの正しい入力
+/// プロトタイプ宣言、コメント、空文、入れ子の呼び出し、代入式の値を使う式を含める
+static const char *ValidSources[] = {
+    "int main() {\n"
+    "    return 0;\n"
+    "}\n",
+
+    "int add(int a, int b);\n"
+    "int twice(int x);\n"
+    "\n"
+    "// 行コメント\n"
+    "int add(int a, int b) {\n"
+    "    return a + b;\n"
+    "}\n"
+    "\n"
+    "/* ブロック\n"
+    "   コメント */\n"
+    "int twice(int x) {\n"
+    "    int y;\n"
+    "    int z;\n"
+    "    ;\n"
+    "    z = x * 2;\n"
+    "    y = z;\n"
+    "    return y = z - 0;\n"
+    "}\n"
+    "\n"
+    "int main() {\n"
+    "    int i;\n"
+    "    i = add(twice(3), add(1, 2)) / 3 - 4 * 5 + 6;\n"
+    "    printnum(add(i = 7, twice(i)));\n"
+    "    return twice(add(i, 1));\n"
+    "}\n",
+};
+
+/// 組み込みの誤りのある入力
+static const char *InvalidSources[] = {
+    // 未宣言の変数
+    "int main() {\n"
+    "    return x;\n"
+    "}\n",
+    // 引数の数の誤り
+    "int f(int a) {\n"
+    "    return a;\n"
+    "}\n"
+    "int main() {\n"
+    "    return f(1, 2);\n"
+    "}\n",
+    // セミコロンの欠落
+    "int main() {\n"
+    "    int i;\n"
+    "    i = 1\n"
+    "    return i;\n"
+    "}\n",
+};
+
+/// 解析で使う保持トークン数 (0は一括、4は逐次字句解析の最小、4096は--streamの既定値)
+static const TokenIndex TokenWindows[] = {0, 4, 4096};
+
+/// 1つの入力を解析する
+/// @param 入力名 ソース 保持するトークン数 正しい入力か
+/// @return 期待どおり: true, そうでない: false
+static bool checkSource(const std::string &name, const std::string &source, TokenIndex window, bool valid) {
+    Parser *parser = new Parser(llvm::MemoryBuffer::getMemBufferCopy(source, name), window);
+    bool parsed = parser->doParse();
+    uint64_t rewinds = parser->getRewindCount();
+    SAFE_DELETE(parser);
+
+    if (parsed != valid) {
+        fprintf(stderr, "FAIL: %s (window %llu): expected %s\n", name.c_str(),
+                (unsigned long long)window, valid ? "success" : "syntax error");
+        return false;
+    }
+    if (valid && rewinds != 0) {
+        fprintf(stderr, "FAIL: %s (window %llu): token stream rewound %llu times\n", name.c_str(),
+                (unsigned long long)window, (unsigned long long)rewinds);
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    std::vector<std::pair<std::string, std::string> > valid;
+    std::vector<std::pair<std::string, std::string> > invalid;
+
+    for (size_t i = 0; i < sizeof(ValidSources) / sizeof(ValidSources[0]); i++) {
+        valid.push_back(std::make_pair("valid" + std::to_string(i) + ".dc", ValidSources[i]));
+    }
+    for (size_t i = 0; i < sizeof(InvalidSources) / sizeof(InvalidSources[0]); i++) {
+        invalid.push_back(std::make_pair("invalid" + std::to_string(i) + ".dc", InvalidSources[i]));
+    }
+
+    // 生成したプログラム (長い式と多くの呼び出しで保持トークン数を超える)
+    for (uint32_t seed = 1; seed <= 4; seed++) {
+        GeneratorConfig config;
+        config.Functions = 20;
+        config.Depth = seed * 4;
+        config.Seed = seed;
+        SourceGenerator generator(config);
+        valid.push_back(std::make_pair("generated" + std::to_string(seed) + ".dc", generator.generate()));
+    }
+
+    for (int i = 1; i < argc; i++) {
+        llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer> > buffer = llvm::MemoryBuffer::getFile(argv[i]);
+        if (!buffer) {
+            fprintf(stderr, "error: cannot read %s\n", argv[i]);
+            return 1;
+        }
+        valid.push_back(std::make_pair(std::string(argv[i]), (*buffer)->getBuffer().str()));
+    }
+
+    unsigned checks = 0;
+    unsigned failures = 0;
+    for (size_t w = 0; w < sizeof(TokenWindows) / sizeof(TokenWindows[0]); w++) {
+        for (size_t i = 0; i < valid.size(); i++, checks++) {
+            failures += !checkSource(valid[i].first, valid[i].second, TokenWindows[w], true);
+        }
+        for (size_t i = 0; i < invalid.size(); i++, checks++) {
+            failures += !checkSource(invalid[i].first, invalid[i].second, TokenWindows[w], false);
+        }
+    }
+
+    fprintf(stdout, "parser: %u passed, %u failed\n", checks - failures, failures);
+    return failures == 0 ? 0 : 1;
+}
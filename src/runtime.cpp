@@ -0,0 +1,27 @@
+// ランタイムのBitcodeの埋め込み
+
+#include "runtime.hpp"
+
+// RUNTIME_BC_PATHはMakefileから渡されるBitcodeのパス
+// アセンブラの.incbinでファイルの中身をそのまま読み出し専用セクションに置く (ELF向け)
+#ifndef RUNTIME_BC_PATH
+#error "RUNTIME_BC_PATH is not defined"
+#endif
+
+asm(".section .rodata\n"
+    ".balign 16\n"
+    ".hidden dcc_runtime_bc_begin\n"
+    ".hidden dcc_runtime_bc_end\n"
+    "dcc_runtime_bc_begin:\n"
+    ".incbin \"" RUNTIME_BC_PATH "\"\n"
+    "dcc_runtime_bc_end:\n"
+    ".previous\n");
+
+extern "C" const char dcc_runtime_bc_begin[];
+extern "C" const char dcc_runtime_bc_end[];
+
+/// dccに埋め込んだランタイムのBitcodeを取得する
+/// @return Bitcodeの先頭から末尾までを指すStringRef
+llvm::StringRef getRuntimeBitcode() {
+    return llvm::StringRef(dcc_runtime_bc_begin, dcc_runtime_bc_end - dcc_runtime_bc_begin);
+}
@@ -0,0 +1,298 @@
+#include "scan.hpp"
+
+#include<atomic>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SCAN_X86 1
+#include<immintrin.h>
+#endif
+
+// S: スカラー版
+// ブロック単位の版でも、ブロックに満たない末尾はこれで処理する
+
+static const char *skipSpacesScalar(const char *cur, const char *end) {
+    while (cur < end && isScanSpace(*cur)) {
+        cur++;
+    }
+    return cur;
+}
+
+static const char *findIdentifierEndScalar(const char *cur, const char *end) {
+    while (cur < end && isScanAlnum(*cur)) {
+        cur++;
+    }
+    return cur;
+}
+
+static const char *findDigitEndScalar(const char *cur, const char *end) {
+    while (cur < end && isScanDigit(*cur)) {
+        cur++;
+    }
+    return cur;
+}
+
+static const char *findNewlineScalar(const char *cur, const char *end) {
+    while (cur < end && *cur != '\n') {
+        cur++;
+    }
+    return cur;
+}
+
+static const char *findCommentEndScalar(const char *cur, const char *end) {
+    while (cur + 1 < end && !(cur[0] == '*' && cur[1] == '/')) {
+        cur++;
+    }
+    return cur + 1 < end ? cur : end;
+}
+
+
+#ifdef SCAN_X86
+// S: SSE2版 (16バイト単位)
+// 文字はすべてASCIIの範囲で比較するので、0x80以上のバイトを負とみなす符号付き比較でよい
+// 各関数は「読み飛ばしてよい文字」のマスクを作り、最初の0のビットを探す
+
+static const char *skipSpacesSSE2(const char *cur, const char *end) {
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i newline = _mm_set1_epi8('\n');
+    const __m128i low = _mm_set1_epi8('\t' - 1);
+    const __m128i high = _mm_set1_epi8('\r' + 1);
+    while (end - cur >= 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)cur);
+        __m128i control = _mm_and_si128(_mm_cmpgt_epi8(v, low), _mm_cmplt_epi8(v, high));
+        __m128i spaces = _mm_or_si128(_mm_cmpeq_epi8(v, space),
+                                      _mm_andnot_si128(_mm_cmpeq_epi8(v, newline), control));
+        unsigned mask = ~(unsigned)_mm_movemask_epi8(spaces) & 0xffff;
+        if (mask) {
+            return cur + __builtin_ctz(mask);
+        }
+        cur += 16;
+    }
+    return skipSpacesScalar(cur, end);
+}
+
+static const char *findIdentifierEndSSE2(const char *cur, const char *end) {
+    const __m128i lower_bit = _mm_set1_epi8(0x20);
+    const __m128i alpha_low = _mm_set1_epi8('a' - 1);
+    const __m128i alpha_high = _mm_set1_epi8('z' + 1);
+    const __m128i digit_low = _mm_set1_epi8('0' - 1);
+    const __m128i digit_high = _mm_set1_epi8('9' + 1);
+    while (end - cur >= 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)cur);
+        __m128i lower = _mm_or_si128(v, lower_bit);
+        __m128i alpha = _mm_and_si128(_mm_cmpgt_epi8(lower, alpha_low), _mm_cmplt_epi8(lower, alpha_high));
+        __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(v, digit_low), _mm_cmplt_epi8(v, digit_high));
+        unsigned mask = ~(unsigned)_mm_movemask_epi8(_mm_or_si128(alpha, digit)) & 0xffff;
+        if (mask) {
+            return cur + __builtin_ctz(mask);
+        }
+        cur += 16;
+    }
+    return findIdentifierEndScalar(cur, end);
+}
+
+static const char *findDigitEndSSE2(const char *cur, const char *end) {
+    const __m128i digit_low = _mm_set1_epi8('0' - 1);
+    const __m128i digit_high = _mm_set1_epi8('9' + 1);
+    while (end - cur >= 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)cur);
+        __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(v, digit_low), _mm_cmplt_epi8(v, digit_high));
+        unsigned mask = ~(unsigned)_mm_movemask_epi8(digit) & 0xffff;
+        if (mask) {
+            return cur + __builtin_ctz(mask);
+        }
+        cur += 16;
+    }
+    return findDigitEndScalar(cur, end);
+}
+
+static const char *findNewlineSSE2(const char *cur, const char *end) {
+    const __m128i newline = _mm_set1_epi8('\n');
+    while (end - cur >= 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)cur);
+        unsigned mask = _mm_movemask_epi8(_mm_cmpeq_epi8(v, newline));
+        if (mask) {
+            return cur + __builtin_ctz(mask);
+        }
+        cur += 16;
+    }
+    return findNewlineScalar(cur, end);
+}
+
+static const char *findCommentEndSSE2(const char *cur, const char *end) {
+    const __m128i star = _mm_set1_epi8('*');
+    const __m128i slash = _mm_set1_epi8('/');
+    // '*'の位置と1バイト後ろの'/'の位置を重ねる
+    while (end - cur >= 17) {
+        __m128i v = _mm_loadu_si128((const __m128i*)cur);
+        __m128i w = _mm_loadu_si128((const __m128i*)(cur + 1));
+        unsigned mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(v, star), _mm_cmpeq_epi8(w, slash)));
+        if (mask) {
+            return cur + __builtin_ctz(mask);
+        }
+        cur += 16;
+    }
+    return findCommentEndScalar(cur, end);
+}
+
+
+// S: AVX2版 (32バイト単位)
+// コンパイル時には-mavx2を要求せず、関数ごとにtarget属性で有効にする
+
+#define SCAN_AVX2_TARGET __attribute__((target("avx2")))
+
+SCAN_AVX2_TARGET
+static const char *skipSpacesAVX2(const char *cur, const char *end) {
+    const __m256i space = _mm256_set1_epi8(' ');
+    const __m256i newline = _mm256_set1_epi8('\n');
+    const __m256i low = _mm256_set1_epi8('\t' - 1);
+    const __m256i high = _mm256_set1_epi8('\r' + 1);
+    while (end - cur >= 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)cur);
+        __m256i control = _mm256_and_si256(_mm256_cmpgt_epi8(v, low), _mm256_cmpgt_epi8(high, v));
+        __m256i spaces = _mm256_or_si256(_mm256_cmpeq_epi8(v, space),
+                                         _mm256_andnot_si256(_mm256_cmpeq_epi8(v, newline), control));
+        unsigned mask = ~(unsigned)_mm256_movemask_epi8(spaces);
+        if (mask) {
+            return cur + __builtin_ctz(mask);
+        }
+        cur += 32;
+    }
+    return skipSpacesSSE2(cur, end);
+}
+
+SCAN_AVX2_TARGET
+static const char *findIdentifierEndAVX2(const char *cur, const char *end) {
+    const __m256i lower_bit = _mm256_set1_epi8(0x20);
+    const __m256i alpha_low = _mm256_set1_epi8('a' - 1);
+    const __m256i alpha_high = _mm256_set1_epi8('z' + 1);
+    const __m256i digit_low = _mm256_set1_epi8('0' - 1);
+    const __m256i digit_high = _mm256_set1_epi8('9' + 1);
+    while (end - cur >= 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)cur);
+        __m256i lower = _mm256_or_si256(v, lower_bit);
+        __m256i alpha = _mm256_and_si256(_mm256_cmpgt_epi8(lower, alpha_low), _mm256_cmpgt_epi8(alpha_high, lower));
+        __m256i digit = _mm256_and_si256(_mm256_cmpgt_epi8(v, digit_low), _mm256_cmpgt_epi8(digit_high, v));
+        unsigned mask = ~(unsigned)_mm256_movemask_epi8(_mm256_or_si256(alpha, digit));
+        if (mask) {
+            return cur + __builtin_ctz(mask);
+        }
+        cur += 32;
+    }
+    return findIdentifierEndSSE2(cur, end);
+}
+
+SCAN_AVX2_TARGET
+static const char *findDigitEndAVX2(const char *cur, const char *end) {
+    const __m256i digit_low = _mm256_set1_epi8('0' - 1);
+    const __m256i digit_high = _mm256_set1_epi8('9' + 1);
+    while (end - cur >= 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)cur);
+        __m256i digit = _mm256_and_si256(_mm256_cmpgt_epi8(v, digit_low), _mm256_cmpgt_epi8(digit_high, v));
+        unsigned mask = ~(unsigned)_mm256_movemask_epi8(digit);
+        if (mask) {
+            return cur + __builtin_ctz(mask);
+        }
+        cur += 32;
+    }
+    return findDigitEndSSE2(cur, end);
+}
+
+SCAN_AVX2_TARGET
+static const char *findNewlineAVX2(const char *cur, const char *end) {
+    const __m256i newline = _mm256_set1_epi8('\n');
+    while (end - cur >= 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)cur);
+        unsigned mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, newline));
+        if (mask) {
+            return cur + __builtin_ctz(mask);
+        }
+        cur += 32;
+    }
+    return findNewlineSSE2(cur, end);
+}
+
+SCAN_AVX2_TARGET
+static const char *findCommentEndAVX2(const char *cur, const char *end) {
+    const __m256i star = _mm256_set1_epi8('*');
+    const __m256i slash = _mm256_set1_epi8('/');
+    while (end - cur >= 33) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)cur);
+        __m256i w = _mm256_loadu_si256((const __m256i*)(cur + 1));
+        unsigned mask = _mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(v, star),
+                                                              _mm256_cmpeq_epi8(w, slash)));
+        if (mask) {
+            return cur + __builtin_ctz(mask);
+        }
+        cur += 32;
+    }
+    return findCommentEndSSE2(cur, end);
+}
+#endif
+
+
+static const ScanKernel ScalarKernel = {
+    "scalar", skipSpacesScalar, findIdentifierEndScalar, findDigitEndScalar,
+    findNewlineScalar, findCommentEndScalar,
+};
+#ifdef SCAN_X86
+static const ScanKernel SSE2Kernel = {
+    "sse2", skipSpacesSSE2, findIdentifierEndSSE2, findDigitEndSSE2,
+    findNewlineSSE2, findCommentEndSSE2,
+};
+static const ScanKernel AVX2Kernel = {
+    "avx2", skipSpacesAVX2, findIdentifierEndAVX2, findDigitEndAVX2,
+    findNewlineAVX2, findCommentEndAVX2,
+};
+#endif
+
+/// 走査コアの取得
+/// @param 種類
+/// @return 走査コア 実行中のCPUで使えなければNULL
+const ScanKernel *getScanKernel(ScanKernelKind kind) {
+    switch (kind) {
+        case SCAN_SCALAR:
+            return &ScalarKernel;
+#ifdef SCAN_X86
+        case SCAN_SSE2:
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("sse2") ? &SSE2Kernel : NULL;
+        case SCAN_AVX2:
+            // OSがAVXのレジスタを保存しない場合もcpu_supportsは偽を返す
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx2") ? &AVX2Kernel : NULL;
+#endif
+        default:
+            return NULL;
+    }
+}
+
+/// 使える中で最も幅の広い走査コアを選ぶ
+static const ScanKernel *selectScanKernel() {
+    const ScanKernel *kernel = NULL;
+    for (int kind = SCAN_KIND_NUM - 1; kind >= 0 && !kernel; kind--) {
+        kernel = getScanKernel((ScanKernelKind)kind);
+    }
+    return kernel;
+}
+
+/// setActiveScanKernelで指定した走査コア (NULLなら自動で選ぶ)
+/// 複数のスレッドがTokenStreamを生成するのでatomicで持つ
+static std::atomic<const ScanKernel*> ActiveKernel(NULL);
+
+/// TokenStreamが使う走査コアの取得
+/// @return 走査コア
+const ScanKernel *getActiveScanKernel() {
+    const ScanKernel *kernel = ActiveKernel.load(std::memory_order_relaxed);
+    if (!kernel) {
+        static const ScanKernel *best = selectScanKernel();
+        kernel = best;
+    }
+    return kernel;
+}
+
+/// TokenStreamが使う走査コアの設定 (計測用)
+/// 以降に生成したTokenStreamから有効になる
+/// @param 走査コア(NULLなら自動で選び直す)
+void setActiveScanKernel(const ScanKernel *kernel) {
+    ActiveKernel.store(kernel, std::memory_order_relaxed);
+}
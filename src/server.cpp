@@ -0,0 +1,178 @@
+// CompileServerクラスのメソッドを実装していく
+
+#include "server.hpp"
+
+/// サーバの実行
+/// ソケットで待ち受け、受け付けた接続をワーカに渡す 停止リクエストを受けるまで戻らない
+/// @return 終了ステータス
+int CompileServer::run() {
+    sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    if (SocketPath.size() >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "socket path is too long: %s\n", SocketPath.c_str());
+        return 1;
+    }
+    SocketPath.copy(addr.sun_path, SocketPath.size());
+
+    ListenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (ListenFd < 0) {
+        perror("socket");
+        return 1;
+    }
+    // 前回のサーバが残したソケットファイルを取り除く
+    unlink(SocketPath.c_str());
+    if (bind(ListenFd, (sockaddr*)&addr, sizeof(addr)) < 0 || listen(ListenFd, 64) < 0) {
+        perror("bind");
+        close(ListenFd);
+        return 1;
+    }
+    fprintf(stderr, "dcc: serving on %s with %u workers\n", SocketPath.c_str(), WorkerNum);
+
+    std::vector<std::thread> workers;
+    for (unsigned i = 0; i < WorkerNum; i++) {
+        workers.push_back(std::thread(&CompileServer::workerLoop, this));
+    }
+
+    // 停止するとstop()がListenFdをshutdownしてacceptが失敗する
+    while (true) {
+        int fd = accept(ListenFd, NULL, NULL);
+        if (fd < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        std::lock_guard<std::mutex> guard(Lock);
+        if (Stopping) {
+            close(fd);
+            break;
+        }
+        Pending.push_back(fd);
+        Ready.notify_one();
+    }
+
+    stop();
+    for (size_t i = 0; i < workers.size(); i++) {
+        workers[i].join();
+    }
+    close(ListenFd);
+    unlink(SocketPath.c_str());
+    return 0;
+}
+
+/// サーバを停止する
+/// 待ち受けを止め、待ち行列が空になった時点でワーカを終了させる
+void CompileServer::stop() {
+    std::lock_guard<std::mutex> guard(Lock);
+    if (!Stopping) {
+        Stopping = true;
+        shutdown(ListenFd, SHUT_RDWR);
+    }
+    Ready.notify_all();
+}
+
+/// ワーカスレッド
+/// 待ち行列から接続を取り出し、接続が閉じられるまでリクエストを処理する
+void CompileServer::workerLoop() {
+    Driver driver(RuntimePath);
+    while (true) {
+        int fd;
+        {
+            std::unique_lock<std::mutex> guard(Lock);
+            Ready.wait(guard, [this]() { return Stopping || !Pending.empty(); });
+            if (Pending.empty()) {
+                return;
+            }
+            fd = Pending.front();
+            Pending.pop_front();
+        }
+        while (handleRequest(driver, fd)) {
+        }
+        close(fd);
+    }
+}
+
+/// リクエストを1つ処理する
+/// 引数はdccのコマンドラインと同じ書式で解釈する 診断メッセージはレスポンスでクライアントに返す
+/// @param ワーカのDriver 接続
+/// @return 続けて次のリクエストを読む: true, 接続を閉じる: false
+bool CompileServer::handleRequest(Driver &driver, int fd) {
+    uint32_t argc;
+    if (!readFully(fd, &argc, sizeof(argc))) {
+        return false;
+    }
+    if (argc == 0) {
+        // 停止リクエスト
+        stop();
+        return false;
+    }
+    if (argc > ProtocolMaxArgs) {
+        fprintf(stderr, "dcc: dropping malformed request (%u arguments)\n", argc);
+        return false;
+    }
+
+    // argv[0]はdcc自身
+    std::vector<std::string> args(argc + 1);
+    args[0] = "dcc";
+    for (uint32_t i = 1; i <= argc; i++) {
+        if (!readString(fd, args[i])) {
+            // 接続が切れたか、長さが上限を超えている
+            return false;
+        }
+    }
+    std::string source;
+    if (!readBlob(fd, source)) {
+        return false;
+    }
+
+    std::vector<char*> argv;
+    for (size_t i = 0; i < args.size(); i++) {
+        argv.push_back(&args[i][0]);
+    }
+    argv.push_back(NULL);
+
+    // 診断メッセージはリクエストごとに集めてレスポンスで返す
+    char *diag_data = NULL;
+    size_t diag_size = 0;
+    FILE *diag = open_memstream(&diag_data, &diag_size);
+    if (!diag) {
+        perror("open_memstream");
+        return false;
+    }
+    diagStream() = diag;
+
+    int32_t status = 1;
+    uint32_t flags = 0;
+    llvm::SmallVector<char, 0> output;
+    OptionParser opt(args.size(), argv.data());
+    if (!opt.parseOption()) {
+        // 不正な引数 (メッセージはparseOptionが出す)
+    } else if (!opt.getServeSocket().empty()) {
+        fprintf(diag, "--serve cannot be requested\n");
+    } else if (opt.getRun()) {
+        // JITはリクエストのコードをサーバのプロセス内で実行してしまう
+        fprintf(diag, "--run cannot be requested\n");
+    } else if (opt.getTimeReport() || !opt.getTracePath().empty() || opt.getMemStats()) {
+        fprintf(diag, "--time-report, --trace and --mem-stats cannot be requested\n");
+    } else if (opt.getInputFileName().empty()) {
+        fprintf(diag, "入力ファイルが指定されていません\n");
+    } else if (opt.getInputFileNames().size() > 1) {
+        fprintf(diag, "1つのリクエストでコンパイルできるのは1ファイルだけです\n");
+    } else {
+        status = driver.compileBuffer(
+            opt, llvm::MemoryBuffer::getMemBufferCopy(source, opt.getInputFileName()), output);
+        if (opt.getOutputKind() == OUTPUT_EXE) {
+            flags |= RESPONSE_EXECUTABLE;
+        }
+    }
+
+    diagStream() = stderr;
+    fclose(diag);
+    bool result = writeFully(fd, &status, sizeof(status)) &&
+                  writeFully(fd, &flags, sizeof(flags)) &&
+                  writeString(fd, status == 0 ? opt.getOutputFileName() : std::string()) &&
+                  writeBlob(fd, output.data(), status == 0 ? output.size() : 0) &&
+                  writeBlob(fd, diag_data, diag_size);
+    free(diag_data);
+    return result;
+}
@@ -0,0 +1,220 @@
+// ASTSimplifierクラスのメソッドを実装していく
+
+#include "simplify.hpp"
+
+// 32bitで折り返す四則演算 (intの桁あふれは未定義なので符号なしで計算する)
+static int wrapAdd(int lhs, int rhs) { return (int32_t)((uint32_t)lhs + (uint32_t)rhs); }
+static int wrapSub(int lhs, int rhs) { return (int32_t)((uint32_t)lhs - (uint32_t)rhs); }
+static int wrapMul(int lhs, int rhs) { return (int32_t)((uint32_t)lhs * (uint32_t)rhs); }
+
+/// 簡約実行
+/// すべての関数定義の本体を簡約する
+/// @return true
+bool ASTSimplifier::doSimplify() {
+    for (int i = 0; i < TU.getFunctionNum(); i++) {
+        simplifyFunction(TU.getFunction(i)->getBody());
+    }
+    return true;
+}
+
+/// 簡約の統計を表示する
+/// @param 出力先
+/// @return true
+bool ASTSimplifier::printStats(FILE *out) {
+    fprintf(out, "simplify: %llu nodes removed, %llu folded, %llu identities, %llu reassociated\n",
+            (unsigned long long)Removed, (unsigned long long)Folded,
+            (unsigned long long)Identities, (unsigned long long)Reassociated);
+    return true;
+}
+
+/// 関数本体の簡約
+/// 式文は簡約した式で置き換える (変数や定数だけになった式文はコードを生成しない)
+/// @param FunctionStmtAST
+void ASTSimplifier::simplifyFunction(FunctionStmtAST *body) {
+    BaseAST *stmt;
+    for (int i = 0; (stmt = body->getStatement(i)); i++) {
+        if (JumpStmtAST *jump_stmt = llvm::dyn_cast<JumpStmtAST>(stmt)) {
+            jump_stmt->setExpr(simplifyExpression(jump_stmt->getExpr()));
+        } else {
+            body->setStatement(i, simplifyExpression(stmt));
+        }
+    }
+}
+
+/// 式の簡約
+/// @param 式のAST
+/// @return 簡約した式のAST (変わらなければ引数と同じ)
+BaseAST *ASTSimplifier::simplifyExpression(BaseAST *expr) {
+    if (BinaryExprAST *bin_expr = llvm::dyn_cast<BinaryExprAST>(expr)) {
+        return simplifyBinaryExpression(bin_expr);
+    } else if (CallExprAST *call_expr = llvm::dyn_cast<CallExprAST>(expr)) {
+        for (int i = 0; call_expr->getArgs(i); i++) {
+            call_expr->setArg(i, simplifyExpression(call_expr->getArgs(i)));
+        }
+    }
+    return expr;
+}
+
+/// 二項演算の簡約
+/// 被演算子を先に簡約し、定数どうしなら畳み込む
+/// 交換できる演算(+, *)は定数を右辺に寄せてから恒等式と定数の連鎖を調べる
+/// @param BinaryExprAST
+/// @return 簡約した式のAST
+BaseAST *ASTSimplifier::simplifyBinaryExpression(BinaryExprAST *bin_expr) {
+    llvm::StringRef op = bin_expr->getOp();
+
+    // 代入式は左辺の変数を残し、右辺だけを簡約する
+    if (op == "=") {
+        bin_expr->setRHS(simplifyExpression(bin_expr->getRHS()));
+        return bin_expr;
+    }
+
+    bin_expr->setLHS(simplifyExpression(bin_expr->getLHS()));
+    bin_expr->setRHS(simplifyExpression(bin_expr->getRHS()));
+    NumberAST *lhs_num = llvm::dyn_cast<NumberAST>(bin_expr->getLHS());
+    NumberAST *rhs_num = llvm::dyn_cast<NumberAST>(bin_expr->getRHS());
+
+    // 定数どうしの演算
+    if (lhs_num && rhs_num) {
+        int value;
+        if (!evaluate(op, lhs_num->getNumberValue(), rhs_num->getNumberValue(), value)) {
+            return bin_expr;
+        }
+        Folded++;
+        Removed += 2;
+        return createNumber(value);
+    }
+
+    // 定数には副作用がないので、被演算子を入れ替えても評価の結果は変わらない
+    if (lhs_num && (op == "+" || op == "*")) {
+        bin_expr->setLHS(bin_expr->getRHS());
+        bin_expr->setRHS(lhs_num);
+        rhs_num = lhs_num;
+    }
+    if (!rhs_num) {
+        return bin_expr;
+    }
+
+    int rhs = rhs_num->getNumberValue();
+    if (op == "+" || op == "-") {
+        return simplifyAdditive(bin_expr, rhs);
+    } else if (op == "*") {
+        return simplifyMultiplicative(bin_expr, rhs);
+    } else if (op == "/" && rhs == 1) {
+        Identities++;
+        Removed += 2;
+        return bin_expr->getLHS();
+    }
+    return bin_expr;
+}
+
+/// 右辺が定数の加減算の簡約
+/// (x+c1)+c2 を x+(c1+c2) に、(x-c1)+c2 を x-(c1-c2) のようにまとめ、
+/// まとめた定数が0なら x にする
+/// @param 右辺が定数の加減算 右辺の値
+/// @return 簡約した式のAST
+BaseAST *ASTSimplifier::simplifyAdditive(BinaryExprAST *bin_expr, int rhs) {
+    BinaryExprAST *inner = llvm::dyn_cast<BinaryExprAST>(bin_expr->getLHS());
+    if (inner && (inner->getOp() == "+" || inner->getOp() == "-") && llvm::isa<NumberAST>(inner->getRHS())) {
+        int inner_rhs = llvm::cast<NumberAST>(inner->getRHS())->getNumberValue();
+        rhs = inner->getOp() == bin_expr->getOp() ? wrapAdd(inner_rhs, rhs) : wrapSub(inner_rhs, rhs);
+        inner->setRHS(createNumber(rhs));
+        bin_expr = inner;
+        Reassociated++;
+        Removed += 2;
+    }
+    if (rhs == 0) {
+        Identities++;
+        Removed += 2;
+        return bin_expr->getLHS();
+    }
+    return bin_expr;
+}
+
+/// 右辺が定数の乗算の簡約
+/// (x*c1)*c2 を x*(c1*c2) にまとめ、まとめた定数が1なら x、
+/// 0で x に副作用がなければ 0 にする
+/// @param 右辺が定数の乗算 右辺の値
+/// @return 簡約した式のAST
+BaseAST *ASTSimplifier::simplifyMultiplicative(BinaryExprAST *bin_expr, int rhs) {
+    BinaryExprAST *inner = llvm::dyn_cast<BinaryExprAST>(bin_expr->getLHS());
+    if (inner && inner->getOp() == "*" && llvm::isa<NumberAST>(inner->getRHS())) {
+        rhs = wrapMul(llvm::cast<NumberAST>(inner->getRHS())->getNumberValue(), rhs);
+        inner->setRHS(createNumber(rhs));
+        bin_expr = inner;
+        Reassociated++;
+        Removed += 2;
+    }
+    if (rhs == 1) {
+        Identities++;
+        Removed += 2;
+        return bin_expr->getLHS();
+    } else if (rhs == 0 && !hasSideEffects(bin_expr->getLHS())) {
+        // 演算子と左辺の式がまとめて0になる
+        Identities++;
+        Removed += 1 + countNodes(bin_expr->getLHS());
+        return bin_expr->getRHS();
+    }
+    return bin_expr;
+}
+
+/// 定数のASTを作る
+/// @param 値
+/// @return NumberAST
+NumberAST *ASTSimplifier::createNumber(int value) {
+    return TU.getArena().create<NumberAST>(value);
+}
+
+/// 定数どうしの演算を評価する
+/// 除算はIRのsdivと同じく0方向に丸める 0除算とINT_MIN/-1は評価しない
+/// @param 演算子 左辺の値 右辺の値 結果の格納先
+/// @return 評価できた: true, できない: false
+bool ASTSimplifier::evaluate(llvm::StringRef op, int lhs, int rhs, int &result) {
+    if (op == "+") {
+        result = wrapAdd(lhs, rhs);
+    } else if (op == "-") {
+        result = wrapSub(lhs, rhs);
+    } else if (op == "*") {
+        result = wrapMul(lhs, rhs);
+    } else if (op == "/") {
+        if (rhs == 0 || (lhs == INT32_MIN && rhs == -1)) {
+            return false;
+        }
+        result = lhs / rhs;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+/// 式に副作用があるか調べる
+/// 関数呼び出しと代入を含む式は取り除けない
+/// @param 式のAST
+/// @return 副作用がある: true, ない: false
+bool ASTSimplifier::hasSideEffects(BaseAST *expr) {
+    if (llvm::isa<CallExprAST>(expr)) {
+        return true;
+    } else if (BinaryExprAST *bin_expr = llvm::dyn_cast<BinaryExprAST>(expr)) {
+        return bin_expr->getOp() == "=" || hasSideEffects(bin_expr->getLHS()) ||
+               hasSideEffects(bin_expr->getRHS());
+    }
+    return false;
+}
+
+/// 式の節点の数を数える
+/// @param 式のAST
+/// @return 節点の数
+uint64_t ASTSimplifier::countNodes(BaseAST *expr) {
+    if (!expr) {
+        return 0;
+    } else if (BinaryExprAST *bin_expr = llvm::dyn_cast<BinaryExprAST>(expr)) {
+        return 1 + countNodes(bin_expr->getLHS()) + countNodes(bin_expr->getRHS());
+    } else if (CallExprAST *call_expr = llvm::dyn_cast<CallExprAST>(expr)) {
+        uint64_t count = 1;
+        for (int i = 0; call_expr->getArgs(i); i++) {
+            count += countNodes(call_expr->getArgs(i));
+        }
+        return count;
+    }
+    return 1;
+}
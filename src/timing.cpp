@@ -0,0 +1,51 @@
+// TimeReportクラスのメソッドを実装していく
+
+#include "timing.hpp"
+
+/// コンストラクタ
+TimeReport::TimeReport()
+    : PhaseGroup("dcc", "Compiler phases"),
+      ParseGroup("parse", "Parse time per function"),
+      CodeGenGroup("codegen", "Code generation time per function") {
+    const char *names[PHASE_NUM][2] = {
+        {"lex", "Lexing"},
+        {"parse", "Parsing"},
+        {"simplify", "AST simplification"},
+        {"codegen", "Code generation"},
+        {"runtime", "Runtime linking"},
+        {"optimize", "Optimization"},
+        {"output", "Output"},
+    };
+    for (int i = 0; i < PHASE_NUM; i++) {
+        Phases[i].init(names[i][0], names[i][1], PhaseGroup);
+    }
+}
+
+/// 関数の構文解析用のTimerを作る
+/// @param 関数名
+/// @return Timer
+llvm::Timer *TimeReport::createParseTimer(llvm::StringRef name) {
+    std::lock_guard<std::mutex> guard(Lock);
+    FunctionTimers.emplace_back();
+    FunctionTimers.back().init(name, name, ParseGroup);
+    return &FunctionTimers.back();
+}
+
+/// 関数のコード生成用のTimerを作る
+/// @param 関数名
+/// @return Timer
+llvm::Timer *TimeReport::createCodeGenTimer(llvm::StringRef name) {
+    std::lock_guard<std::mutex> guard(Lock);
+    FunctionTimers.emplace_back();
+    FunctionTimers.back().init(name, name, CodeGenGroup);
+    return &FunctionTimers.back();
+}
+
+/// 計測結果を表示する
+/// 表示した計測結果は消去し、破棄時に再び表示されないようにする
+/// @param 出力先
+void TimeReport::print(llvm::raw_ostream &out) {
+    PhaseGroup.print(out, true);
+    ParseGroup.print(out, true);
+    CodeGenGroup.print(out, true);
+}